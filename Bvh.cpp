@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <numeric>
+#include "Bvh.h"
+
+namespace sg_gui {
+
+const unsigned int Bvh::LeafSize;
+
+void
+Bvh::build(const std::vector<float>& bounds) {
+
+	unsigned int numPrimitives = bounds.size()/6;
+
+	_nodes.clear();
+	_primitives.resize(numPrimitives);
+	std::iota(_primitives.begin(), _primitives.end(), 0);
+
+	if (numPrimitives == 0)
+		return;
+
+	std::vector<float> centers(3*numPrimitives);
+	for (unsigned int i = 0; i < numPrimitives; i++)
+		for (int d = 0; d < 3; d++)
+			centers[3*i + d] = 0.5f*(bounds[6*i + d] + bounds[6*i + 3 + d]);
+
+	// a binary tree with at most LeafSize primitives per leaf
+	_nodes.reserve(2*(numPrimitives/LeafSize + 1));
+
+	buildNode(bounds, centers, 0, numPrimitives);
+}
+
+unsigned int
+Bvh::buildNode(
+		const std::vector<float>& bounds,
+		const std::vector<float>& centers,
+		unsigned int              begin,
+		unsigned int              end) {
+
+	unsigned int index = _nodes.size();
+	_nodes.push_back(Node());
+
+	// bounds of the primitives and of their centers
+	float min[3], max[3], centerMin[3], centerMax[3];
+	for (int d = 0; d < 3; d++) {
+
+		min[d] = centerMin[d] =  std::numeric_limits<float>::max();
+		max[d] = centerMax[d] = -std::numeric_limits<float>::max();
+	}
+
+	for (unsigned int i = begin; i < end; i++) {
+
+		unsigned int p = _primitives[i];
+
+		for (int d = 0; d < 3; d++) {
+
+			min[d] = std::min(min[d], bounds[6*p + d]);
+			max[d] = std::max(max[d], bounds[6*p + 3 + d]);
+			centerMin[d] = std::min(centerMin[d], centers[3*p + d]);
+			centerMax[d] = std::max(centerMax[d], centers[3*p + d]);
+		}
+	}
+
+	for (int d = 0; d < 3; d++) {
+
+		_nodes[index].min[d] = min[d];
+		_nodes[index].max[d] = max[d];
+	}
+
+	// split along the longest axis of the centers
+	int axis = 0;
+	for (int d = 1; d < 3; d++)
+		if (centerMax[d] - centerMin[d] > centerMax[axis] - centerMin[axis])
+			axis = d;
+
+	if (end - begin <= LeafSize || centerMax[axis] == centerMin[axis]) {
+
+		_nodes[index].index = begin;
+		_nodes[index].count = end - begin;
+
+		return index;
+	}
+
+	unsigned int middle = begin + (end - begin)/2;
+
+	std::nth_element(
+			_primitives.begin() + begin,
+			_primitives.begin() + middle,
+			_primitives.begin() + end,
+			[&centers, axis](unsigned int a, unsigned int b) {
+				return centers[3*a + axis] < centers[3*b + axis];
+			});
+
+	// the first child follows directly
+	buildNode(bounds, centers, begin, middle);
+	unsigned int second = buildNode(bounds, centers, middle, end);
+
+	_nodes[index].index = second;
+	_nodes[index].count = 0;
+
+	return index;
+}
+
+} // namespace sg_gui
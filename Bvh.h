@@ -0,0 +1,209 @@
+#ifndef SG_GUI_BVH_H__
+#define SG_GUI_BVH_H__
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include <util/ray.hpp>
+
+namespace sg_gui {
+
+/**
+ * A bounding volume hierarchy over a set of primitives, given by their
+ * bounding boxes. Used to find the closest primitive along a ray without
+ * testing all of them.
+ */
+class Bvh {
+
+public:
+
+	/**
+	 * Build the hierarchy over the given primitive bounding boxes, six floats
+	 * (min x, y, z, max x, y, z) per primitive. Primitives are identified by
+	 * their index in bounds.
+	 */
+	void build(const std::vector<float>& bounds);
+
+	/**
+	 * Find the closest primitive hit by a ray.
+	 *
+	 * @param ray
+	 *              The ray to intersect with.
+	 *
+	 * @param t
+	 *              Set to the ray parameter of the closest hit.
+	 *
+	 * @param primitive
+	 *              Set to the index of the closest primitive hit.
+	 *
+	 * @param intersectPrimitive
+	 *              A function bool(unsigned int primitive, float& t) that
+	 *              tests a single primitive and sets t on a hit.
+	 *
+	 * @return true, if a primitive was hit.
+	 */
+	template <typename F>
+	bool intersect(
+			const util::ray<float,3>& ray,
+			float&                    t,
+			unsigned int&             primitive,
+			F                         intersectPrimitive) const;
+
+	/**
+	 * The number of primitives in this hierarchy.
+	 */
+	std::size_t getNumPrimitives() const { return _primitives.size(); }
+
+private:
+
+	struct Node {
+
+		float min[3];
+		float max[3];
+
+		// for inner nodes, the index of the second child (the first one
+		// follows the node directly), for leafs the index of the first
+		// primitive in _primitives
+		unsigned int index;
+
+		// the number of primitives in a leaf, 0 for inner nodes
+		unsigned int count;
+	};
+
+	// the maximal number of primitives per leaf
+	static const unsigned int LeafSize = 4;
+
+	unsigned int buildNode(
+			const std::vector<float>& bounds,
+			const std::vector<float>& centers,
+			unsigned int              begin,
+			unsigned int              end);
+
+	/**
+	 * Slab test of a ray (given by position and inverse direction) against a
+	 * node's box. Sets tmin to the entry point.
+	 */
+	static bool intersectNode(
+			const Node&  node,
+			const float* position,
+			const float* inverseDirection,
+			float        tmax,
+			float&       tmin);
+
+	std::vector<Node>         _nodes;
+	std::vector<unsigned int> _primitives;
+};
+
+/*****************
+ * IMPLEMENTAION *
+ *****************/
+
+template <typename F>
+bool
+Bvh::intersect(
+		const util::ray<float,3>& ray,
+		float&                    t,
+		unsigned int&             primitive,
+		F                         intersectPrimitive) const {
+
+	if (_nodes.empty())
+		return false;
+
+	const float position[3] = {
+			ray.position().x(),
+			ray.position().y(),
+			ray.position().z() };
+	const float inverseDirection[3] = {
+			1.0f/ray.direction().x(),
+			1.0f/ray.direction().y(),
+			1.0f/ray.direction().z() };
+
+	bool hit = false;
+	t = std::numeric_limits<float>::max();
+
+	// the depth is bounded by the median splits
+	unsigned int stack[64];
+	unsigned int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0) {
+
+		const Node& node = _nodes[stack[--stackSize]];
+
+		float tnode;
+		if (!intersectNode(node, position, inverseDirection, t, tnode))
+			continue;
+
+		if (node.count > 0) {
+
+			for (unsigned int i = node.index; i < node.index + node.count; i++) {
+
+				float tprimitive;
+				if (intersectPrimitive(_primitives[i], tprimitive) && tprimitive < t) {
+
+					t = tprimitive;
+					primitive = _primitives[i];
+					hit = true;
+				}
+			}
+
+			continue;
+		}
+
+		unsigned int first  = &node - &_nodes[0] + 1;
+		unsigned int second = node.index;
+
+		// visit the closer child first, i.e., push it last
+		float tfirst, tsecond;
+		bool hitFirst  = intersectNode(_nodes[first],  position, inverseDirection, t, tfirst);
+		bool hitSecond = intersectNode(_nodes[second], position, inverseDirection, t, tsecond);
+
+		if (hitFirst && hitSecond && tfirst < tsecond) {
+
+			stack[stackSize++] = second;
+			stack[stackSize++] = first;
+
+		} else {
+
+			if (hitFirst)
+				stack[stackSize++] = first;
+			if (hitSecond)
+				stack[stackSize++] = second;
+		}
+	}
+
+	return hit;
+}
+
+inline bool
+Bvh::intersectNode(
+		const Node&  node,
+		const float* position,
+		const float* inverseDirection,
+		float        tmax,
+		float&       tmin) {
+
+	tmin = 0;
+
+	for (int d = 0; d < 3; d++) {
+
+		float t0 = (node.min[d] - position[d])*inverseDirection[d];
+		float t1 = (node.max[d] - position[d])*inverseDirection[d];
+
+		if (t0 > t1)
+			std::swap(t0, t1);
+
+		tmin = std::max(tmin, t0);
+		tmax = std::min(tmax, t1);
+
+		if (tmin > tmax)
+			return false;
+	}
+
+	return true;
+}
+
+} // namespace sg_gui
+
+#endif // SG_GUI_BVH_H__
+
@@ -1,8 +1,187 @@
 #include <cmath>
+#include <cstring>
+#include <memory>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 #include "Colors.h"
 
 namespace sg_gui {
 
+namespace {
+
+// the constants of idToRgb()
+const double HueFactor        = 0.4671057256451202;
+const double SaturationFactor = 0.6262286337141059;
+const double ValueFactor      = 0.9424373277692188;
+
+// for each of the six hue sectors of hsvToRgb(), the indices of r, g, and b 
+// into (v, p, q, t)
+const unsigned char Sectors[6][3] = {
+	{ 0, 3, 1 },
+	{ 2, 0, 1 },
+	{ 1, 0, 3 },
+	{ 1, 2, 0 },
+	{ 3, 1, 0 },
+	{ 0, 1, 2 }
+};
+
+/**
+ * The last stage of idsToRgb(): pick r, g, and b from v, p, q, and t (already 
+ * scaled to [0,255]) according to the hue sector.
+ */
+inline void selectRgb(uint64_t id, unsigned int sector, const int* vpqt, uint8_t* rgba) {
+
+	if (id == 0) {
+
+		rgba[0] = rgba[1] = rgba[2] = 0;
+
+	} else {
+
+		rgba[0] = vpqt[Sectors[sector][0]];
+		rgba[1] = vpqt[Sectors[sector][1]];
+		rgba[2] = vpqt[Sectors[sector][2]];
+	}
+
+	rgba[3] = 255;
+}
+
+/**
+ * idToRgb() for a single id, without branches on the hue sector.
+ */
+inline void idToRgba(uint64_t id, uint8_t* rgba) {
+
+	double d = static_cast<double>(id);
+
+	float x = std::fmod(HueFactor*d, 1.0);
+	float y = std::fmod(SaturationFactor*d, 1.0);
+	float z = std::fmod(ValueFactor*d, 1.0);
+
+	double h = x;
+	double s = static_cast<float>(0.25 + y*0.75);
+	double v = static_cast<float>(0.5 + z*0.5);
+
+	// h is rounded to float and can be 1 (e.g., for id 9488171), which is 
+	// sector 0 again with f = 0, as in hsvToRgb()
+	unsigned int i = h*6;
+	double f = (h*6) - i;
+	i %= 6;
+
+	int vpqt[4] = {
+		static_cast<int>(255.0*v),
+		static_cast<int>(255.0*(v*(1.0 - s))),
+		static_cast<int>(255.0*(v*(1.0 - s*f))),
+		static_cast<int>(255.0*(v*(1.0 - s*(1.0 - f))))
+	};
+
+	selectRgb(id, i, vpqt, rgba);
+}
+
+#ifdef __SSE2__
+
+/**
+ * x - floor(x) for two non-negative doubles, exact.
+ */
+inline __m128d fract(__m128d x) {
+
+	// adding and subtracting 2^52 rounds to the closest integer
+	const __m128d magic = _mm_set1_pd(4503599627370496.0);
+	const __m128d one   = _mm_set1_pd(1.0);
+
+	__m128d rounded = _mm_sub_pd(_mm_add_pd(x, magic), magic);
+	__m128d floored = _mm_sub_pd(rounded, _mm_and_pd(_mm_cmpgt_pd(rounded, x), one));
+
+	// doubles from 2^52 on are integers, for which the rounding above does 
+	// not hold
+	return _mm_and_pd(_mm_sub_pd(x, floored), _mm_cmplt_pd(x, magic));
+}
+
+/**
+ * Round two doubles to float precision, as the float variables of idToRgb() 
+ * do.
+ */
+inline __m128d toFloat(__m128d x) {
+
+	return _mm_cvtps_pd(_mm_cvtpd_ps(x));
+}
+
+/**
+ * idToRgb() for two ids at once.
+ */
+inline void idsToRgba(uint64_t id0, uint64_t id1, uint8_t* rgba) {
+
+	const __m128d one = _mm_set1_pd(1.0);
+
+	__m128d d = _mm_set_pd(static_cast<double>(id1), static_cast<double>(id0));
+
+	__m128d h = toFloat(fract(_mm_mul_pd(d, _mm_set1_pd(HueFactor))));
+	__m128d y = toFloat(fract(_mm_mul_pd(d, _mm_set1_pd(SaturationFactor))));
+	__m128d z = toFloat(fract(_mm_mul_pd(d, _mm_set1_pd(ValueFactor))));
+
+	__m128d s = toFloat(_mm_add_pd(_mm_set1_pd(0.25), _mm_mul_pd(y, _mm_set1_pd(0.75))));
+	__m128d v = toFloat(_mm_add_pd(_mm_set1_pd(0.5),  _mm_mul_pd(z, _mm_set1_pd(0.5))));
+
+	__m128d h6     = _mm_mul_pd(h, _mm_set1_pd(6.0));
+	__m128i sector = _mm_cvttpd_epi32(h6);
+	__m128d f      = _mm_sub_pd(h6, _mm_cvtepi32_pd(sector));
+
+	// wrap sector 6 (for a hue rounded to 1) to 0, see idToRgba()
+	const __m128i six = _mm_set1_epi32(6);
+	sector = _mm_sub_epi32(sector, _mm_and_si128(_mm_cmpeq_epi32(sector, six), six));
+
+	__m128d p = _mm_mul_pd(v, _mm_sub_pd(one, s));
+	__m128d q = _mm_mul_pd(v, _mm_sub_pd(one, _mm_mul_pd(s, f)));
+	__m128d t = _mm_mul_pd(v, _mm_sub_pd(one, _mm_mul_pd(s, _mm_sub_pd(one, f))));
+
+	const __m128d scale = _mm_set1_pd(255.0);
+
+	int vs[4], ps[4], qs[4], ts[4], sectors[4];
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(vs), _mm_cvttpd_epi32(_mm_mul_pd(v, scale)));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(ps), _mm_cvttpd_epi32(_mm_mul_pd(p, scale)));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(qs), _mm_cvttpd_epi32(_mm_mul_pd(q, scale)));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(ts), _mm_cvttpd_epi32(_mm_mul_pd(t, scale)));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(sectors), sector);
+
+	int vpqt0[4] = { vs[0], ps[0], qs[0], ts[0] };
+	int vpqt1[4] = { vs[1], ps[1], qs[1], ts[1] };
+
+	selectRgb(id0, sectors[0], vpqt0, rgba);
+	selectRgb(id1, sectors[1], vpqt1, rgba + 4);
+}
+
+#endif // __SSE2__
+
+/**
+ * A direct-mapped cache of the colors of recent ids.
+ */
+struct ColorCache {
+
+	static const std::size_t Size = 4096;
+
+	ColorCache() {
+
+		// all slots start with id 0, which is black
+		for (std::size_t i = 0; i < Size; i++) {
+
+			ids[i] = 0;
+			pending[i] = 0;
+			rgba[i][0] = rgba[i][1] = rgba[i][2] = 0;
+			rgba[i][3] = 255;
+		}
+	}
+
+	static std::size_t slot(uint64_t id) { return (id ^ (id >> 12)) & (Size - 1); }
+
+	uint64_t ids[Size];
+	uint8_t  rgba[Size][4];
+
+	// for ids whose color is being computed, one plus their position in the 
+	// current batch of idsToRgb()
+	uint16_t pending[Size];
+};
+
+} // anonymous namespace
+
 void
 hsvToRgb(double h, double s, double v, unsigned char& r, unsigned char& g, unsigned char& b) {
 
@@ -71,4 +250,98 @@ idToRgb(unsigned int id, unsigned char& r, unsigned char& g, unsigned char& b) {
 	hsvToRgb(h, s, v, r, g, b);
 }
 
+
+void
+idsToRgb(const uint64_t* ids, std::size_t n, uint8_t* rgba) {
+
+	// per thread, such that idsToRgb() can be called from workers
+	static thread_local std::unique_ptr<ColorCache> cache;
+
+	if (!cache)
+		cache.reset(new ColorCache());
+
+	const std::size_t BatchSize = 256;
+
+	// the ids that were not found in the cache and where their colors go
+	uint64_t    missed[BatchSize];
+	uint8_t*    targets[BatchSize];
+	std::size_t numMissed = 0;
+
+	// repetitions of missed ids, to be copied once their color is known
+	uint8_t*    copyTargets[BatchSize];
+	std::size_t copySources[BatchSize];
+	std::size_t numCopies = 0;
+
+	auto computeBatch = [&]() {
+
+		std::size_t i = 0;
+
+#ifdef __SSE2__
+		uint8_t computed[8];
+
+		for (; i + 1 < numMissed; i += 2) {
+
+			idsToRgba(missed[i], missed[i + 1], computed);
+			std::memcpy(targets[i],     computed,     4);
+			std::memcpy(targets[i + 1], computed + 4, 4);
+		}
+#endif
+
+		for (; i < numMissed; i++)
+			idToRgba(missed[i], targets[i]);
+
+		// fill the cache, unless a slot was taken by a later id of the batch
+		for (i = 0; i < numMissed; i++) {
+
+			std::size_t slot = ColorCache::slot(missed[i]);
+
+			if (cache->pending[slot] == i + 1) {
+
+				std::memcpy(cache->rgba[slot], targets[i], 4);
+				cache->pending[slot] = 0;
+			}
+		}
+
+		for (i = 0; i < numCopies; i++)
+			std::memcpy(copyTargets[i], targets[copySources[i]], 4);
+
+		numMissed = 0;
+		numCopies = 0;
+	};
+
+	for (std::size_t i = 0; i < n; i++, rgba += 4) {
+
+		uint64_t    id   = ids[i];
+		std::size_t slot = ColorCache::slot(id);
+
+		if (cache->ids[slot] == id) {
+
+			if (cache->pending[slot] == 0) {
+
+				std::memcpy(rgba, cache->rgba[slot], 4);
+				continue;
+			}
+
+			copyTargets[numCopies] = rgba;
+			copySources[numCopies] = cache->pending[slot] - 1;
+
+			if (++numCopies == BatchSize)
+				computeBatch();
+
+			continue;
+		}
+
+		cache->ids[slot]     = id;
+		cache->pending[slot] = numMissed + 1;
+
+		missed[numMissed]  = id;
+		targets[numMissed] = rgba;
+
+		if (++numMissed == BatchSize)
+			computeBatch();
+	}
+
+	computeBatch();
+}
+
 } // namespace sg_gui
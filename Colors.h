@@ -1,6 +1,9 @@
 #ifndef SG_GUI_COLORS_H__
 #define SG_GUI_COLORS_H__
 
+#include <cstddef>
+#include <cstdint>
+
 namespace sg_gui {
 
 /**
@@ -13,6 +16,24 @@ void hsvToRgb(double h, double s, double v, unsigned char& r, unsigned char& g,
  */
 void idToRgb(unsigned int id, unsigned char& r, unsigned char& g, unsigned char& b);
 
+/**
+ * Get the colors of many ids at once, as RGBA with an alpha of 255. Gives 
+ * the same colors as idToRgb() for ids that fit into an unsigned int, but 
+ * computes two ids at a time with SSE2 (if available) and remembers the 
+ * colors of recent ids, such that repeated ids (as in label images) are 
+ * cheap.
+ *
+ * @param ids
+ *              The ids to get the colors for.
+ *
+ * @param n
+ *              The number of ids.
+ *
+ * @param rgba
+ *              Receives 4*n bytes, four per id.
+ */
+void idsToRgb(const uint64_t* ids, std::size_t n, uint8_t* rgba);
+
 } // namespace sg_gui
 
 #endif // SG_GUI_COLORS_H__
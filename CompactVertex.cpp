@@ -0,0 +1,75 @@
+#include <algorithm>
+#include <cmath>
+#include "CompactVertex.h"
+
+namespace sg_gui {
+
+namespace {
+
+/**
+ * Map a unit normal to two coordinates in [-1,1] on the octahedron.
+ */
+void octahedralEncode(const float* n, float& u, float& v) {
+
+	float l1 = std::abs(n[0]) + std::abs(n[1]) + std::abs(n[2]);
+	u = n[0]/l1;
+	v = n[1]/l1;
+
+	// fold the lower hemisphere over the diagonals
+	if (n[2] < 0) {
+
+		float fu = (1 - std::abs(v))*(u >= 0 ? 1 : -1);
+		float fv = (1 - std::abs(u))*(v >= 0 ? 1 : -1);
+		u = fu;
+		v = fv;
+	}
+}
+
+int16_t toSnorm16(float x) {
+
+	return static_cast<int16_t>(std::round(std::min(1.0f, std::max(-1.0f, x))*32767));
+}
+
+} // anonymous namespace
+
+void
+encodeCompact(
+		const Mesh&                 mesh,
+		std::vector<CompactVertex>& vertices,
+		float                       positionOffset[3],
+		float                       positionScale[3]) {
+
+	static_assert(sizeof(CompactVertex) == 12, "CompactVertex has to be packed");
+
+	unsigned int numVertices = mesh.getNumVertices();
+
+	// quantize positions in the bounding box
+	const util::box<float,3>& bb = mesh.getBoundingBox();
+	float extent[3] = { bb.width(), bb.height(), bb.depth() };
+	for (int d = 0; d < 3; d++) {
+
+		positionOffset[d] = bb.min()[d];
+		positionScale[d]  = (extent[d] > 0 ? extent[d]/65535.0f : 1.0f);
+	}
+
+	vertices.resize(numVertices);
+	const float* positions = mesh.getPositionData();
+	const float* normals   = mesh.getNormalData();
+
+	for (unsigned int i = 0; i < numVertices; i++) {
+
+		for (int d = 0; d < 3; d++) {
+
+			float q = std::round((positions[3*i + d] - positionOffset[d])/positionScale[d]);
+			vertices[i].position[d] = static_cast<int16_t>(std::min(65535.0f, std::max(0.0f, q)) - 32768);
+		}
+
+		float u, v;
+		octahedralEncode(&normals[3*i], u, v);
+		vertices[i].normal[0] = toSnorm16(u);
+		vertices[i].normal[1] = toSnorm16(v);
+		vertices[i].padding   = 0;
+	}
+}
+
+} // namespace sg_gui
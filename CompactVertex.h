@@ -0,0 +1,42 @@
+#ifndef SG_GUI_COMPACT_VERTEX_H__
+#define SG_GUI_COMPACT_VERTEX_H__
+
+#include <cstdint>
+#include <vector>
+#include "Mesh.h"
+
+namespace sg_gui {
+
+/**
+ * A mesh vertex in the compact GPU encoding, half the size of a float
+ * position and normal: the position is quantized to 16 bit in the bounding
+ * box of its mesh, the normal is stored as two 16 bit octahedral coordinates
+ * (with an error below 0.005 degrees).
+ */
+struct CompactVertex {
+
+	// quantized position, shifted to the range of signed shorts
+	int16_t position[3];
+
+	// octahedral normal as signed normalized shorts
+	int16_t normal[2];
+
+	// keeps vertices four-byte aligned
+	int16_t padding;
+};
+
+/**
+ * Encode the vertices of a mesh. The decoded position of a vertex is
+ *
+ *   positionOffset + (position + 32768)*positionScale
+ */
+void encodeCompact(
+		const Mesh&                 mesh,
+		std::vector<CompactVertex>& vertices,
+		float                       positionOffset[3],
+		float                       positionScale[3]);
+
+} // namespace sg_gui
+
+#endif // SG_GUI_COMPACT_VERTEX_H__
+
@@ -0,0 +1,68 @@
+#include "OpenGl.h"
+#include "Frustum.h"
+
+namespace sg_gui {
+
+Frustum::Frustum() {
+
+	float modelview[16];
+	float projection[16];
+
+	glCheck(glGetFloatv(GL_MODELVIEW_MATRIX,  modelview));
+	glCheck(glGetFloatv(GL_PROJECTION_MATRIX, projection));
+
+	extractPlanes(modelview, projection);
+}
+
+Frustum::Frustum(const float* modelview, const float* projection) {
+
+	extractPlanes(modelview, projection);
+}
+
+bool
+Frustum::intersects(const util::box<float,3>& box) const {
+
+	for (int i = 0; i < 6; i++) {
+
+		const float* p = _planes[i];
+
+		// the corner of the box that is furthest along the plane normal
+		float x = (p[0] >= 0 ? box.max().x() : box.min().x());
+		float y = (p[1] >= 0 ? box.max().y() : box.min().y());
+		float z = (p[2] >= 0 ? box.max().z() : box.min().z());
+
+		// if even this corner is outside, the whole box is
+		if (p[0]*x + p[1]*y + p[2]*z + p[3] < 0)
+			return false;
+	}
+
+	return true;
+}
+
+void
+Frustum::extractPlanes(const float* modelview, const float* projection) {
+
+	// clip = projection*modelview, column-major
+	float m[16];
+	for (int c = 0; c < 4; c++)
+		for (int r = 0; r < 4; r++) {
+
+			m[c*4 + r] = 0;
+			for (int k = 0; k < 4; k++)
+				m[c*4 + r] += projection[k*4 + r]*modelview[c*4 + k];
+		}
+
+	// row i of the clip matrix
+	auto row = [&m](int i, int j) { return m[j*4 + i]; };
+
+	// a point is inside if -w <= x,y,z <= w, which gives the planes
+	// w + x, w - x, w + y, w - y, w + z, w - z
+	for (int i = 0; i < 3; i++)
+		for (int j = 0; j < 4; j++) {
+
+			_planes[2*i    ][j] = row(3, j) + row(i, j);
+			_planes[2*i + 1][j] = row(3, j) - row(i, j);
+		}
+}
+
+} // namespace sg_gui
@@ -0,0 +1,48 @@
+#ifndef SG_GUI_FRUSTUM_H__
+#define SG_GUI_FRUSTUM_H__
+
+#include <util/box.hpp>
+
+namespace sg_gui {
+
+/**
+ * The viewing frustum of the current OpenGl transformation, represented by
+ * six planes in object coordinates.
+ */
+class Frustum {
+
+public:
+
+	/**
+	 * Extract the frustum from the current modelview and projection matrices.
+	 * Requires an active OpenGl context. The frustum is expressed in the
+	 * object coordinates of the current modelview matrix, i.e., it can be
+	 * tested directly against bounding boxes of what is drawn next.
+	 */
+	Frustum();
+
+	/**
+	 * Extract the frustum from the given column-major modelview and
+	 * projection matrices.
+	 */
+	Frustum(const float* modelview, const float* projection);
+
+	/**
+	 * Conservative test whether a box is (partially) inside the frustum. May
+	 * report true for boxes that are close to, but outside of, a corner of
+	 * the frustum.
+	 */
+	bool intersects(const util::box<float,3>& box) const;
+
+private:
+
+	void extractPlanes(const float* modelview, const float* projection);
+
+	// the planes (a, b, c, d) with ax + by + cz + d >= 0 for points inside
+	float _planes[6][4];
+};
+
+} // namespace sg_gui
+
+#endif // SG_GUI_FRUSTUM_H__
+
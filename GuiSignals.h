@@ -167,6 +167,12 @@ public:
 
 	bool needsRedraw() { return _needsRedraw; }
 
+	/**
+	 * Request another redraw after this one, e.g., for content that could not 
+	 * be drawn completely in this frame.
+	 */
+	void setNeedsRedraw() { _needsRedraw = true; }
+
 private:
 
 	bool _needsRedraw;
@@ -185,7 +191,44 @@ typedef DrawOpaque Draw;
 /**
  * Draw signal for drawing translucent content.
  */
-class DrawTranslucent : public DrawBase { public: typedef DrawBase parent_type; };
+class DrawTranslucent : public DrawBase {
+
+public:
+
+	typedef DrawBase parent_type;
+
+	DrawTranslucent() :
+		_orderIndependent(false),
+		_orderIndependentContent(false) {}
+
+	/**
+	 * If true, a DrawOrderIndependentTranslucent signal can follow this one. 
+	 * Views that support it should draw their translucent content there 
+	 * instead, and say so with setOrderIndependentContent().
+	 */
+	bool& orderIndependent() { return _orderIndependent; }
+
+	/**
+	 * To be called by views that skipped this signal to draw in the 
+	 * order-independent pass. Without any, that pass is skipped.
+	 */
+	void setOrderIndependentContent() { _orderIndependentContent = true; }
+
+	bool hasOrderIndependentContent() const { return _orderIndependentContent; }
+
+private:
+
+	bool _orderIndependent;
+
+	bool _orderIndependentContent;
+};
+
+/**
+ * Draw signal for drawing translucent content with weighted blended 
+ * order-independent transparency. Receivers have to write to two color 
+ * buffers, see OitBuffer.
+ */
+class DrawOrderIndependentTranslucent : public DrawBase { public: typedef DrawBase parent_type; };
 
 /**
  * Base class for signals used to set the content of views.
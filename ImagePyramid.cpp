@@ -0,0 +1,128 @@
+#include <algorithm>
+#include <util/Logger.h>
+#include "ImagePyramid.h"
+
+logger::LogChannel imagepyramidlog("imagepyramidlog", "[ImagePyramid] ");
+
+namespace sg_gui {
+
+ImagePyramid::ImagePyramid(std::shared_ptr<Image> image, unsigned int tileSize, bool isLabelImage) :
+	_image(image),
+	_isLabelImage(isLabelImage) {
+
+	const float* source = data(0);
+	unsigned int width  = _image->width();
+	unsigned int height = _image->height();
+
+	while (width > tileSize || height > tileSize) {
+
+		_levels.push_back(Level());
+		Level& level = _levels.back();
+
+		level.width  = (width  + 1)/2;
+		level.height = (height + 1)/2;
+		level.data.resize(static_cast<std::size_t>(level.width)*level.height);
+
+		downsample(source, width, height, level, util::box<unsigned int,2>(0, 0, level.width, level.height));
+
+		source = level.data.data();
+		width  = level.width;
+		height = level.height;
+
+		LOG_DEBUG(imagepyramidlog)
+				<< "created level " << _levels.size() << " of size "
+				<< width << "x" << height << std::endl;
+	}
+}
+
+void
+ImagePyramid::update(const util::box<unsigned int,2>& region) {
+
+	const float* source = data(0);
+	unsigned int width  = _image->width();
+	unsigned int height = _image->height();
+
+	for (unsigned int l = 0; l < _levels.size(); l++) {
+
+		Level& level = _levels[l];
+
+		downsample(source, width, height, level, levelRegion(region, l + 1));
+
+		source = level.data.data();
+		width  = level.width;
+		height = level.height;
+	}
+}
+
+util::box<unsigned int,2>
+ImagePyramid::levelRegion(const util::box<unsigned int,2>& region, unsigned int level) {
+
+	unsigned int minX = region.min().x();
+	unsigned int minY = region.min().y();
+	unsigned int maxX = region.max().x();
+	unsigned int maxY = region.max().y();
+
+	// a pixel depends on the two pixels at 2x and 2x + 1 of the previous 
+	// level, in both directions
+	for (unsigned int l = 0; l < level; l++) {
+
+		minX /= 2;
+		minY /= 2;
+		maxX = (maxX + 1)/2;
+		maxY = (maxY + 1)/2;
+	}
+
+	return util::box<unsigned int,2>(minX, minY, maxX, maxY);
+}
+
+unsigned int
+ImagePyramid::width(unsigned int level) const {
+
+	return (level == 0 ? _image->width() : _levels[level - 1].width);
+}
+
+unsigned int
+ImagePyramid::height(unsigned int level) const {
+
+	return (level == 0 ? _image->height() : _levels[level - 1].height);
+}
+
+const float*
+ImagePyramid::data(unsigned int level) const {
+
+	return (level == 0 ? &(*_image->begin()) : _levels[level - 1].data.data());
+}
+
+void
+ImagePyramid::downsample(
+		const float*                     source,
+		unsigned int                     sourceWidth,
+		unsigned int                     sourceHeight,
+		Level&                           target,
+		const util::box<unsigned int,2>& region) {
+
+	unsigned int maxX = std::min(region.max().x(), target.width);
+	unsigned int maxY = std::min(region.max().y(), target.height);
+
+	for (unsigned int y = region.min().y(); y < maxY; y++) {
+
+		float* t = target.data.data() + static_cast<std::size_t>(y)*target.width + region.min().x();
+
+		// the last row and column of odd sizes are repeated
+		const float* row0 = source + static_cast<std::size_t>(2*y)*sourceWidth;
+		const float* row1 = (2*y + 1 < sourceHeight ? row0 + sourceWidth : row0);
+
+		for (unsigned int x = region.min().x(); x < maxX; x++) {
+
+			unsigned int x0 = 2*x;
+			unsigned int x1 = (x0 + 1 < sourceWidth ? x0 + 1 : x0);
+
+			if (_isLabelImage)
+				*t++ = mode(row0[x0], row0[x1], row1[x0], row1[x1]);
+			else
+				*t++ = 0.25f*(row0[x0] + row0[x1] + row1[x0] + row1[x1]);
+		}
+	}
+}
+
+} // namespace sg_gui
@@ -0,0 +1,101 @@
+#ifndef SG_GUI_IMAGE_PYRAMID_H__
+#define SG_GUI_IMAGE_PYRAMID_H__
+
+#include <memory>
+#include <vector>
+#include <imageprocessing/Image.h>
+#include <util/box.hpp>
+
+namespace sg_gui {
+
+/**
+ * A multi-resolution pyramid of an image. Level 0 is the image itself, every
+ * following level halves the width and height of the previous one, until a
+ * level fits into a single tile of the given size.
+ *
+ * Intensity images are downsampled by averaging 2x2 pixels. Label images
+ * keep the most frequent label of each 2x2 block, to not
+ * mix labels.
+ */
+class ImagePyramid {
+
+public:
+
+	/**
+	 * Create a pyramid for the given image, down to a level that fits into
+	 * one tile of tileSize x tileSize pixels. The image has to stay unchanged
+	 * while the pyramid is used, except for changes passed to update().
+	 */
+	ImagePyramid(std::shared_ptr<Image> image, unsigned int tileSize, bool isLabelImage);
+
+	/**
+	 * Recompute the pixels of all levels that depend on the given region of
+	 * the image (in pixels of level 0), after it was changed.
+	 */
+	void update(const util::box<unsigned int,2>& region);
+
+	/**
+	 * Get the region of the given level that depends on the given region of
+	 * level 0.
+	 */
+	static util::box<unsigned int,2> levelRegion(const util::box<unsigned int,2>& region, unsigned int level);
+
+	unsigned int getNumLevels() const { return _levels.size() + 1; }
+
+	unsigned int width(unsigned int level) const;
+	unsigned int height(unsigned int level) const;
+
+	/**
+	 * The pixels of a level, row by row.
+	 */
+	const float* data(unsigned int level) const;
+
+	/**
+	 * True, if the image was downsampled as a label image.
+	 */
+	bool isLabelImage() const { return _isLabelImage; }
+
+private:
+
+	struct Level {
+
+		unsigned int       width;
+		unsigned int       height;
+		std::vector<float> data;
+	};
+
+	/**
+	 * Compute the pixels of target within the given region (in pixels of the
+	 * target) from the previous level.
+	 */
+	void downsample(
+			const float*                     source,
+			unsigned int                     sourceWidth,
+			unsigned int                     sourceHeight,
+			Level&                           target,
+			const util::box<unsigned int,2>& region);
+
+	/**
+	 * The most frequent of four labels, a if they are all different.
+	 */
+	static float mode(float a, float b, float c, float d) {
+
+		if (b == c || b == d)
+			return b;
+		if (c == d)
+			return c;
+		return a;
+	}
+
+	std::shared_ptr<Image> _image;
+
+	// levels 1, 2, ...
+	std::vector<Level> _levels;
+
+	bool _isLabelImage;
+};
+
+} // namespace sg_gui
+
+#endif // SG_GUI_IMAGE_PYRAMID_H__
+
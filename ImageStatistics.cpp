@@ -0,0 +1,174 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include <util/Logger.h>
+#include "ImageStatistics.h"
+#include "ThreadPool.h"
+
+logger::LogChannel imagestatisticslog("imagestatisticslog", "[ImageStatistics] ");
+
+namespace sg_gui {
+
+const unsigned int ImageStatistics::NumBins;
+
+namespace {
+
+// the number of values below which statistics are computed in the calling
+// thread
+const std::size_t MinParallelSize = 1 << 20;
+
+ThreadPool& getThreadPool() {
+
+	static ThreadPool pool;
+
+	return pool;
+}
+
+/**
+ * Update min and max with the finite values of values[0..n). Not finite
+ * values (NaN and infinity) are skipped, they would otherwise propagate into
+ * the result or collapse the histogram into a single bin.
+ */
+void minmax(const float* values, std::size_t n, float& min, float& max) {
+
+	std::size_t i = 0;
+
+#ifdef __SSE2__
+
+	if (n >= 4) {
+
+		__m128  mins    = _mm_set1_ps(min);
+		__m128  maxs    = _mm_set1_ps(max);
+		__m128  highest = _mm_set1_ps(std::numeric_limits<float>::max());
+		__m128  lowest  = _mm_set1_ps(std::numeric_limits<float>::lowest());
+		__m128i absMask = _mm_set1_epi32(0x7fffffff);
+		__m128i expMask = _mm_set1_epi32(0x7f800000);
+
+		for (; i + 4 <= n; i += 4) {
+
+			__m128 v = _mm_loadu_ps(values + i);
+
+			// a value is finite if its exponent is not all ones
+			__m128i bits   = _mm_and_si128(_mm_castps_si128(v), absMask);
+			__m128  finite = _mm_castsi128_ps(_mm_cmplt_epi32(bits, expMask));
+
+			// replace not finite values with the neutral element
+			mins = _mm_min_ps(mins, _mm_or_ps(_mm_and_ps(finite, v), _mm_andnot_ps(finite, highest)));
+			maxs = _mm_max_ps(maxs, _mm_or_ps(_mm_and_ps(finite, v), _mm_andnot_ps(finite, lowest)));
+		}
+
+		float m[4];
+		_mm_storeu_ps(m, mins);
+		min = std::min(std::min(m[0], m[1]), std::min(m[2], m[3]));
+		_mm_storeu_ps(m, maxs);
+		max = std::max(std::max(m[0], m[1]), std::max(m[2], m[3]));
+	}
+
+#endif // __SSE2__
+
+	for (; i < n; i++) {
+
+		if (!std::isfinite(values[i]))
+			continue;
+
+		min = std::min(min, values[i]);
+		max = std::max(max, values[i]);
+	}
+}
+
+} // anonymous namespace
+
+template <typename F>
+std::size_t
+ImageStatistics::forEachChunk(std::size_t n, F f) {
+
+	if (n < MinParallelSize) {
+
+		f(0, n, 0);
+		return 1;
+	}
+
+	ThreadPool& pool = getThreadPool();
+
+	std::size_t numChunks = pool.getNumThreads();
+	std::size_t chunkSize = (n + numChunks - 1)/numChunks;
+
+	std::vector<std::future<void>> done;
+	for (std::size_t chunk = 0; chunk < numChunks; chunk++) {
+
+		std::size_t begin = chunk*chunkSize;
+		std::size_t end   = std::min(n, begin + chunkSize);
+
+		done.push_back(pool.schedule([&f, begin, end, chunk](){ f(begin, end, chunk); }));
+	}
+
+	for (auto& d : done)
+		d.get();
+
+	return numChunks;
+}
+
+ImageStatistics::ImageStatistics(const float* values, std::size_t n) :
+	_min(0),
+	_max(0),
+	_histogram(NumBins, 0) {
+
+	if (n == 0)
+		return;
+
+	std::size_t numThreads = getThreadPool().getNumThreads();
+
+	// per chunk minima and maxima
+
+	std::vector<float> mins(numThreads, std::numeric_limits<float>::max());
+	std::vector<float> maxs(numThreads, std::numeric_limits<float>::lowest());
+
+	std::size_t numChunks = forEachChunk(n, [&](std::size_t begin, std::size_t end, std::size_t chunk) {
+
+		minmax(values + begin, end - begin, mins[chunk], maxs[chunk]);
+	});
+
+	_min = *std::min_element(mins.begin(), mins.begin() + numChunks);
+	_max = *std::max_element(maxs.begin(), maxs.begin() + numChunks);
+
+	// no finite values at all
+	if (_min > _max) {
+
+		_min = 0;
+		_max = 0;
+	}
+
+	// per chunk histograms
+
+	std::vector<std::vector<std::size_t>> histograms(numThreads, std::vector<std::size_t>(NumBins, 0));
+
+	// in double, the range of finite floats can overflow a float
+	double scale = (_max > _min ? NumBins/(static_cast<double>(_max) - _min) : 0.0);
+
+	forEachChunk(n, [&](std::size_t begin, std::size_t end, std::size_t chunk) {
+
+		std::vector<std::size_t>& histogram = histograms[chunk];
+
+		for (std::size_t i = begin; i < end; i++) {
+
+			if (!std::isfinite(values[i]))
+				continue;
+
+			unsigned int bin = static_cast<unsigned int>((values[i] - static_cast<double>(_min))*scale);
+			histogram[std::min(bin, NumBins - 1)]++;
+		}
+	});
+
+	for (std::size_t chunk = 0; chunk < numChunks; chunk++)
+		for (unsigned int bin = 0; bin < NumBins; bin++)
+			_histogram[bin] += histograms[chunk][bin];
+
+	LOG_ALL(imagestatisticslog)
+			<< "values of " << n << " pixels are in [" << _min << ", " << _max
+			<< "], computed in " << numChunks << " chunks" << std::endl;
+}
+
+} // namespace sg_gui
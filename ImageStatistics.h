@@ -0,0 +1,60 @@
+#ifndef SG_GUI_IMAGE_STATISTICS_H__
+#define SG_GUI_IMAGE_STATISTICS_H__
+
+#include <vector>
+
+namespace sg_gui {
+
+/**
+ * Statistics of the values of an image or volume: minimum, maximum, whether
+ * the values are label ids, and a histogram. Computed once in parallel, to be
+ * shared between everybody showing the same data. Values that are not
+ * finite (NaN or infinity) are ignored. Create new statistics after modifying
+ * the values.
+ */
+class ImageStatistics {
+
+public:
+
+	// the number of bins of the histogram
+	static const unsigned int NumBins = 256;
+
+	/**
+	 * Compute the statistics of n values.
+	 */
+	ImageStatistics(const float* values, std::size_t n);
+
+	float getMin() const { return _min; }
+	float getMax() const { return _max; }
+
+	/**
+	 * True, if values above one are to be shown as label colors.
+	 */
+	bool isLabelImage() const { return _max > 1.0; }
+
+	/**
+	 * The number of values in each of NumBins bins of equal size between the
+	 * minimum and the maximum.
+	 */
+	const std::vector<std::size_t>& getHistogram() const { return _histogram; }
+
+private:
+
+	/**
+	 * Split [0, n) into about equally sized chunks and call
+	 * f(begin, end, chunk) for each of them, in parallel for large images.
+	 * Returns the number of chunks.
+	 */
+	template <typename F>
+	static std::size_t forEachChunk(std::size_t n, F f);
+
+	float _min;
+	float _max;
+
+	std::vector<std::size_t> _histogram;
+};
+
+} // namespace sg_gui
+
+#endif // SG_GUI_IMAGE_STATISTICS_H__
+
@@ -1,34 +1,216 @@
+#include <algorithm>
+#include <cmath>
+#include <util/ProgramOptions.h>
+#include <util/Logger.h>
 #include "Colors.h"
 #include "ImageView.h"
 
+logger::LogChannel imageviewlog("imageviewlog", "[ImageView] ");
+
+util::ProgramOption optionTiledImages(
+		util::_long_name        = "tiledImages",
+		util::_description_text = "Show all images tiled with a multi-resolution pyramid, not only those larger than the maximal texture size.");
+
+util::ProgramOption optionMipmapImages(
+		util::_long_name        = "mipmapImages",
+		util::_description_text = "Create mipmaps for untiled images, for faster and smoother drawing of zoomed-out images.");
+
+util::ProgramOption optionImageTileSize(
+		util::_long_name        = "imageTileSize",
+		util::_description_text = "The size of the texture tiles for tiled images in pixels.",
+		util::_default_value    = 512);
+
+util::ProgramOption optionImageTileCacheSize(
+		util::_long_name        = "imageTileCacheSize",
+		util::_description_text = "The number of texture tiles of tiled images to keep on the GPU.",
+		util::_default_value    = 256);
+
 namespace sg_gui {
 
+const unsigned int ImageView::MaxTileUploadsPerFrame;
+
+static const char* imageVertexShader = R"(
+#version 130
+
+void main() {
+
+	gl_Position    = ftransform();
+	gl_TexCoord[0] = gl_MultiTexCoord0;
+	gl_FrontColor  = gl_Color;
+}
+)";
+
+// Colors ids like idToRgb() (see Colors.cpp): the fractional parts of the id 
+// times three constants give hue, saturation, and value. The constants are 
+// given as 64 bit fixed point fractions (high and low 32 bits), such that the 
+// fractional parts can be computed exactly with 32 bit integer arithmetic. 
+// Intensities (and values below one of label images) are windowed and 
+// optionally mapped through a lookup table.
+static const char* imageFragmentShader = R"(
+#version 130
+
+uniform sampler2D image;
+
+// show values of at least one as label ids
+uniform bool labels;
+
+// the intensity window
+uniform float scale;
+uniform float bias;
+uniform float gamma;
+
+// the lookup table for windowed intensities, if lutSize > 0
+uniform sampler1D lut;
+uniform float     lutSize;
+
+// the high 32 bits of a*b
+uint mulHigh(uint a, uint b) {
+
+	uint a0 = a & 0xffffu;
+	uint a1 = a >> 16;
+	uint b0 = b & 0xffffu;
+	uint b1 = b >> 16;
+
+	uint low    = a0*b0;
+	uint middle0 = a1*b0;
+	uint middle1 = a0*b1;
+
+	uint carry = (low >> 16) + (middle0 & 0xffffu) + (middle1 & 0xffffu);
+
+	return a1*b1 + (middle0 >> 16) + (middle1 >> 16) + (carry >> 16);
+}
+
+// fract(c*id) for c = (high*2^32 + low)/2^64
+float fractMul(uint high, uint low, uint id) {
+
+	uint f = high*id + mulHigh(low, id);
+
+	return float(f >> 8)/16777216.0;
+}
+
+vec3 hsvToRgb(float h, float s, float v) {
+
+	float h6 = h*6.0;
+	uint  i  = uint(h6);
+	float f  = h6 - float(i);
+	float p  = v*(1.0 - s);
+	float q  = v*(1.0 - s*f);
+	float t  = v*(1.0 - s*(1.0 - f));
+
+	vec3 rgb;
+	switch (i%6u) {
+	case 0u: rgb = vec3(v, t, p); break;
+	case 1u: rgb = vec3(q, v, p); break;
+	case 2u: rgb = vec3(p, v, t); break;
+	case 3u: rgb = vec3(p, q, v); break;
+	case 4u: rgb = vec3(t, p, v); break;
+	default: rgb = vec3(v, p, q); break;
+	}
+
+	// quantize like the conversion to unsigned char
+	return floor(rgb*255.0)/255.0;
+}
+
+void main() {
+
+	float value = texture2D(image, gl_TexCoord[0].st).r;
+
+	vec3 rgb;
+
+	if (labels && value >= 1.0) {
+
+		uint id = uint(value);
+
+		float h = fractMul(0x77943da7u, 0x6b8e4800u, id);
+		float s = 0.25 + fractMul(0xa050850du, 0x9eefe000u, id)*0.75;
+		float v = 0.5  + fractMul(0xf143929du, 0x4c65c000u, id)*0.5;
+
+		rgb = hsvToRgb(h, s, v);
+
+	} else {
+
+		float intensity = pow(clamp(value*scale + bias, 0.0, 1.0), gamma);
+
+		// sample at the centers of the first and last entry for 0 and 1
+		if (lutSize > 0.0)
+			rgb = texture1D(lut, (intensity*(lutSize - 1.0) + 0.5)/lutSize).rgb;
+		else
+			rgb = vec3(intensity);
+	}
+
+	gl_FragColor = vec4(rgb, 1.0)*gl_Color;
+}
+)";
+
+namespace {
+
+/**
+ * Intensities above one are handled as color indices, intensities below one 
+ * as grayscale.
+ */
+void toRgba(const float* values, std::size_t n, boost::array<unsigned char, 4>* pixels) {
+
+	static_assert(sizeof(boost::array<unsigned char, 4>) == 4, "pixels have to be packed");
+
+	const std::size_t ChunkSize = 1024;
+	uint64_t ids[ChunkSize];
+
+	for (std::size_t begin = 0; begin < n; begin += ChunkSize) {
+
+		std::size_t size = std::min(ChunkSize, n - begin);
+
+		for (std::size_t i = 0; i < size; i++)
+			ids[i] = (values[begin + i] >= 1.0 ? static_cast<unsigned int>(values[begin + i]) : 0);
+
+		idsToRgb(ids, size, pixels[begin].data());
+
+		for (std::size_t i = 0; i < size; i++) {
+
+			float value = values[begin + i];
+
+			if (value < 1.0) {
+
+				boost::array<unsigned char, 4>& pixel = pixels[begin + i];
+				pixel[0] = value*255.0;
+				pixel[1] = value*255.0;
+				pixel[2] = value*255.0;
+			}
+		}
+	}
+}
+
+} // anonymous namespace
+
 ImageView::~ImageView() {
 
-	if (_texture != 0)
-		delete _texture;
+	if (_lutTexture) {
+
+		OpenGl::Guard guard;
+
+		glCheck(glDeleteTextures(1, &_lutTexture));
+	}
 }
 
 void
-ImageView::onSignal(DrawOpaque& /*signal*/) {
+ImageView::onSignal(DrawOpaque& signal) {
 
 	if (_alpha < 1.0)
 		return;
 
-	draw();
+	draw(signal);
 }
 
 void
-ImageView::onSignal(DrawTranslucent& /*signal*/) {
+ImageView::onSignal(DrawTranslucent& signal) {
 
 	if (_alpha == 1.0)
 		return;
 
-	draw();
+	draw(signal);
 }
 
 void
-ImageView::draw() {
+ImageView::draw(DrawBase& signal) {
 
 	// wait for image
 	if (!_image)
@@ -38,16 +220,101 @@ ImageView::draw() {
 	if (_image->width() == 0 || _image->height() == 0)
 		return;
 
-	if (_needReload)
-		loadTexture();
+	if (_needReload) {
+
+		GLint maxTextureSize;
+		glCheck(glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize));
+
+		_tiled =
+				optionTiledImages ||
+				_image->width()  > static_cast<unsigned int>(maxTextureSize) ||
+				_image->height() > static_cast<unsigned int>(maxTextureSize);
+
+		if (_tiled)
+			loadPyramid();
+		else
+			loadTexture();
+
+	} else if (_dirty) {
+
+		loadRegion();
+	}
 
 	glEnable(GL_TEXTURE_2D);
 	glDisable(GL_CULL_FACE);
 
-	_texture->bind();
-
 	glColor4f(_red, _green, _blue, _alpha);
 
+	if (_shaderColors)
+		bindShader();
+
+	if (_tiled) {
+
+		drawTiles(signal);
+
+	} else {
+
+		drawTexture();
+	}
+
+	if (_shaderColors) {
+
+		_shader->unbind();
+
+		glCheck(glActiveTexture(GL_TEXTURE1));
+		glCheck(glBindTexture(GL_TEXTURE_1D, 0));
+		glCheck(glActiveTexture(GL_TEXTURE0));
+	}
+
+	glDisable(GL_TEXTURE_2D);
+}
+
+void
+ImageView::bindShader() {
+
+	if (!_shader)
+		_shader.reset(new ShaderProgram(imageVertexShader, imageFragmentShader));
+
+	if (_lutChanged) {
+
+		if (!_lutTexture) {
+
+			glCheck(glGenTextures(1, &_lutTexture));
+			glCheck(glBindTexture(GL_TEXTURE_1D, _lutTexture));
+			glCheck(glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+			glCheck(glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+			glCheck(glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+		}
+
+		glCheck(glBindTexture(GL_TEXTURE_1D, _lutTexture));
+
+		if (!_lut.empty())
+			glCheck(glTexImage1D(GL_TEXTURE_1D, 0, GL_RGBA8, _lut.size(), 0, GL_RGBA, GL_UNSIGNED_BYTE, _lut[0].data()));
+
+		glCheck(glBindTexture(GL_TEXTURE_1D, 0));
+
+		_lutChanged = false;
+	}
+
+	_shader->bind();
+	_shader->setUniform("image", 0);
+	_shader->setUniform("labels", _labelImage ? 1 : 0);
+	_shader->setUniform("scale", _scale);
+	_shader->setUniform("bias", _bias);
+	_shader->setUniform("gamma", _gamma);
+	_shader->setUniform("lut", 1);
+	_shader->setUniform("lutSize", static_cast<float>(_lut.size()));
+
+	glCheck(glActiveTexture(GL_TEXTURE1));
+	glCheck(glBindTexture(GL_TEXTURE_1D, _lutTexture));
+	glCheck(glActiveTexture(GL_TEXTURE0));
+}
+
+void
+ImageView::drawTexture() {
+
+	_texture->bind();
+
 	const util::box<float,3>& bb = _image->getBoundingBox();
 	float minX = bb.min().x();
 	float minY = bb.min().y();
@@ -62,9 +329,7 @@ ImageView::draw() {
 	glTexCoord2d(0.0, 0.0); glVertex3d(minX, minY, z);
 	glEnd();
 
-	glDisable(GL_TEXTURE_2D);
-
-	return;
+	_texture->unbind();
 }
 
 void
@@ -79,12 +344,79 @@ ImageView::onSignal(QuerySize& signal) {
 void
 ImageView::onSignal(SetImage& signal) {
 
-	_image = signal.getImage();
+	_image      = signal.getImage();
+	_statistics = signal.getStatistics();
 	_needReload = true;
 
 	send<ContentChanged>();
 }
 
+void
+ImageView::onSignal(ImageRegionChanged& signal) {
+
+	updateRegion(signal.getRegion());
+}
+
+void
+ImageView::updateRegion(const util::box<unsigned int,2>& region) {
+
+	if (!_image)
+		return;
+
+	unsigned int minX = region.min().x();
+	unsigned int minY = region.min().y();
+	unsigned int maxX = std::min(region.max().x(), static_cast<unsigned int>(_image->width()));
+	unsigned int maxY = std::min(region.max().y(), static_cast<unsigned int>(_image->height()));
+
+	if (minX >= maxX || minY >= maxY)
+		return;
+
+	// the values changed
+	_statistics.reset();
+
+	if (_dirty) {
+
+		_dirtyRegion.min().x() = std::min(_dirtyRegion.min().x(), minX);
+		_dirtyRegion.min().y() = std::min(_dirtyRegion.min().y(), minY);
+		_dirtyRegion.max().x() = std::max(_dirtyRegion.max().x(), maxX);
+		_dirtyRegion.max().y() = std::max(_dirtyRegion.max().y(), maxY);
+
+	} else {
+
+		_dirtyRegion = util::box<unsigned int,2>(minX, minY, maxX, maxY);
+		_dirty = true;
+	}
+
+	send<ContentChanged>();
+}
+
+void
+ImageView::onSignal(ChangeIntensityWindow& signal) {
+
+	_scale = signal.getScale();
+	_bias  = signal.getBias();
+	_gamma = signal.getGamma();
+
+	// without shader, the window is applied while uploading
+	if (!_shaderColors)
+		_needReload = true;
+
+	send<ContentChanged>();
+}
+
+void
+ImageView::onSignal(SetLookupTable& signal) {
+
+	_lut = signal.getLookupTable();
+	_lutChanged = true;
+
+	if (!_shaderColors && !_lut.empty())
+		LOG_USER(imageviewlog)
+				<< "lookup tables need shader support, showing gray values" << std::endl;
+
+	send<ContentChanged>();
+}
+
 void
 ImageView::onSignal(ChangeAlpha& signal) {
 
@@ -102,61 +434,482 @@ ImageView::loadTexture() {
 	// ensure that OpenGl operations are save
 	OpenGl::Guard guard;
 
-	if (!_texture) {
+	// free the tiles and the pyramid of a previous tiled image
+	_coarsestTile.reset();
+	_tileCache.reset();
+	_pyramid.reset();
+
+	_labelImage = getStatistics().isLabelImage();
+
+	// images are uploaded as they are and colored on the GPU, if possible
+	_shaderColors = isShaderSupported();
+
+	GLint format = (_shaderColors ? GL_R32F : GL_RGBA);
+
+	// label mipmaps are created on the CPU
+	bool mipmaps = optionMipmapImages && (_labelImage || Texture::canGenerateMipmaps());
+
+	// get a texture of the new size or format, the previous one returns to 
+	// the pool
+	if (!_texture ||
+	    _texture->format()     != format ||
+	    _texture->hasMipmaps() != mipmaps ||
+	    _texture->width()      != static_cast<GLsizei>(_image->width()) ||
+	    _texture->height()     != static_cast<GLsizei>(_image->height()))
+		_texture = TexturePool::get(_image->width(), _image->height(), format, mipmaps);
+
+	// label images colored on the CPU are uploaded as RGBA, all others as 
+	// they are
+	bool   colorize = (_labelImage && !_shaderColors);
+	GLenum pixelFormat = (_shaderColors ? GL_RED : (colorize ? GL_RGBA : GL_LUMINANCE));
+	GLenum pixelType   = (colorize ? GL_UNSIGNED_BYTE : GL_FLOAT);
+
+	if (!_uploader ||
+	    _uploader->width()  != _texture->width() ||
+	    _uploader->height() != _texture->height() ||
+	    _uploader->format() != pixelFormat ||
+	    _uploader->type()   != pixelType)
+		_uploader.reset(new TextureUploader(_texture->width(), _texture->height(), pixelFormat, pixelType, 2));
+
+	// map, fill, and upload run back to back here, so a single reload does 
+	// not overlap with anything and uses one buffer. Only the next reload 
+	// benefits, which fills the second buffer instead of waiting for the GPU 
+	// to finish reading this one.
+	unsigned int slot = _uploader->map();
+
+	if (colorize)
+		toRgba(&(*_image->begin()), _image->size(), _uploader->getData<boost::array<unsigned char, 4> >(slot));
+	else if (!_shaderColors && !_labelImage)
+		applyWindow(&(*_image->begin()), _image->size(), _uploader->getData<float>(slot));
+	else
+		std::copy(_image->begin(), _image->end(), _uploader->getData<float>(slot));
+
+	_uploader->upload(slot, *_texture);
+
+	if (mipmaps)
+		loadMipmaps();
 
-		_texture = new Texture(_image->width(), _image->height(), GL_RGBA);
+	_needReload = false;
+	_dirty      = false;
+}
 
-	} else {
+const ImageStatistics&
+ImageView::getStatistics() {
 
-		if (_image->width()  != _texture->width() ||
-		    _image->height() != _texture->height()) {
+	if (!_statistics)
+		_statistics = std::make_shared<ImageStatistics>(&(*_image->begin()), _image->size());
 
-			_texture->resize(_image->width(), _image->height());
+	return *_statistics;
+}
+
+void
+ImageView::loadRegion() {
+
+	_dirty = false;
+
+	// without shader, windowed intensities are easier to upload as a whole 
+	// (tiles are windowed one by one)
+	if (!_tiled && !_shaderColors && !_labelImage && !isIdentityWindow()) {
+
+		loadTexture();
+		return;
+	}
+
+	// ensure that OpenGl operations are save
+	OpenGl::Guard guard;
+
+	const float* image  = &(*_image->begin());
+	unsigned int width  = _image->width();
+	unsigned int minX   = _dirtyRegion.min().x();
+	unsigned int minY   = _dirtyRegion.min().y();
+	unsigned int sizeX  = _dirtyRegion.width();
+	unsigned int sizeY  = _dirtyRegion.height();
+
+	if (!_labelImage) {
+
+		// an intensity image that became a label image needs a different 
+		// texture, unless colored by the shader, and a pyramid of labels
+		for (unsigned int y = minY; y < minY + sizeY && !_labelImage; y++)
+			for (unsigned int x = minX; x < minX + sizeX; x++)
+				if (image[static_cast<std::size_t>(y)*width + x] > 1.0) {
+
+					_labelImage = true;
+					break;
+				}
+
+		if (_labelImage && _tiled) {
+
+			loadPyramid();
+			return;
 		}
+
+		if (_labelImage && !_shaderColors) {
+
+			loadTexture();
+			return;
+		}
+	}
+
+	if (_tiled) {
+
+		updateTiles();
+		return;
+	}
+
+	// mode-pooled label mipmaps are computed from the whole image
+	if (_labelImage && _texture->hasMipmaps()) {
+
+		loadTexture();
+		return;
 	}
 
-	float min = 0.0f;
-	float max = 1.0f;
-	_image->minmax(&min, &max);
+	LOG_ALL(imageviewlog) << "updating image region " << _dirtyRegion << std::endl;
+
+	if (_labelImage && !_shaderColors) {
 
-	if (max > 1.0) {
+		// colorize the region row by row
+		std::vector<boost::array<unsigned char, 4> > colorRegion(static_cast<std::size_t>(sizeX)*sizeY);
 
-		// consider this image as a color index image
-		std::vector<boost::array<unsigned char, 4> > colorImage;
-		colorImage.reserve(_image->size());
+		for (unsigned int y = 0; y < sizeY; y++)
+			toRgba(
+					image + static_cast<std::size_t>(minY + y)*width + minX,
+					sizeX,
+					&colorRegion[static_cast<std::size_t>(y)*sizeX]);
 
-		boost::array<unsigned char, 4> pixel;
-		pixel[3] = 255;
+		_texture->loadData(&colorRegion[0], _dirtyRegion);
 
-		for (typename Image::iterator i = _image->begin(); i != _image->end(); i++) {
+		return;
+	}
 
-			// fire
-			//float h = ((*i) - min)/(max - min);//fmod(static_cast<float>(*i)*M_PI, 1.0);
+	// values are uploaded as they are, straight out of the image
+	_texture->loadRawData(
+			image,
+			_dirtyRegion,
+			width,
+			_shaderColors ? GL_RED : GL_LUMINANCE,
+			GL_FLOAT);
 
-			// intensities above one are handled as color indices
-			if (*i >= 1.0) {
+	if (_texture->hasMipmaps())
+		_texture->generateMipmaps();
+}
+
+void
+ImageView::updateTiles() {
 
-				idToRgb(*i, pixel[0], pixel[1], pixel[2]);
+	LOG_ALL(imageviewlog) << "updating pyramid and tiles in region " << _dirtyRegion << std::endl;
 
-			// intensities below 1 are handled as grayscale
-			} else {
+	_pyramid->update(_dirtyRegion);
 
-				pixel[0] = (*i)*255.0;
-				pixel[1] = (*i)*255.0;
-				pixel[2] = (*i)*255.0;
+	unsigned int tileSize  = _tileCache->getTileSize();
+	unsigned int numLevels = _pyramid->getNumLevels();
+	unsigned int numTiles  = 0;
+
+	for (unsigned int level = 0; level < numLevels; level++) {
+
+		util::box<unsigned int,2> region = ImagePyramid::levelRegion(_dirtyRegion, level);
+
+		unsigned int beginX = region.min().x()/tileSize;
+		unsigned int beginY = region.min().y()/tileSize;
+		unsigned int endX   = (region.max().x() + tileSize - 1)/tileSize;
+		unsigned int endY   = (region.max().y() + tileSize - 1)/tileSize;
+
+		// tiles that are not cached will be loaded from the pyramid when 
+		// they are needed
+		for (unsigned int y = beginY; y < endY; y++)
+			for (unsigned int x = beginX; x < endX; x++) {
+
+				TextureTileCache::Key key(level, x, y);
+
+				Texture* texture = (level == numLevels - 1 ? _coarsestTile.get() : _tileCache->get(key));
+
+				if (texture) {
+
+					loadTile(key, *texture);
+					numTiles++;
+				}
 			}
-			colorImage.push_back(pixel);
+	}
+
+	LOG_ALL(imageviewlog) << "reloaded " << numTiles << " cached tiles" << std::endl;
+}
+
+void
+ImageView::loadMipmaps() {
+
+	if (!_labelImage) {
+
+		// intensities can be averaged on the GPU
+		_texture->generateMipmaps();
+		_texture->setFilters(GL_LINEAR_MIPMAP_LINEAR, GL_NEAREST);
+
+		return;
+	}
+
+	// labels must not be mixed, take the most frequent one of each 2x2 block 
+	// instead
+	ImagePyramid pyramid(_image, 1, true);
+
+	for (unsigned int level = 1; level < _texture->numLevels(); level++) {
+
+		// the pyramid rounds sizes up, OpenGl down: upload only the first 
+		// rows and columns of each pyramid level
+		const float* data = pyramid.data(level);
+		unsigned int width = pyramid.width(level);
+
+		if (_shaderColors) {
+
+			_texture->loadLevel(level, data, width, GL_RED, GL_FLOAT);
+
+		} else {
+
+			std::vector<boost::array<unsigned char, 4> > colorLevel(static_cast<std::size_t>(width)*pyramid.height(level));
+
+			toRgba(data, colorLevel.size(), &colorLevel[0]);
+
+			_texture->loadLevel(level, &colorLevel[0], width, GL_RGBA, GL_UNSIGNED_BYTE);
 		}
+	}
 
-		_texture->loadData(&(*colorImage.begin()));
+	// pick ids, don't interpolate them
+	_texture->setFilters(GL_NEAREST_MIPMAP_NEAREST, GL_NEAREST);
+}
+
+void
+ImageView::loadPyramid() {
+
+	// ensure that OpenGl operations are save
+	OpenGl::Guard guard;
+
+	_texture.reset();
+	_uploader.reset();
+
+	unsigned int tileSize = optionImageTileSize;
+
+	unsigned int capacity = optionImageTileCacheSize;
+
+	_labelImage = getStatistics().isLabelImage();
+
+	_pyramid.reset(new ImagePyramid(_image, tileSize, _labelImage));
+
+	_shaderColors = isShaderSupported();
+
+	_tileCache.reset(new TextureTileCache(tileSize, capacity, _shaderColors ? GL_R32F : GL_RGBA));
+	_coarsestTile.reset();
+
+	LOG_DEBUG(imageviewlog)
+			<< "showing image of size " << _image->width() << "x" << _image->height()
+			<< " tiled with " << _pyramid->getNumLevels() << " levels" << std::endl;
+
+	_needReload = false;
+	_dirty      = false;
+}
+
+void
+ImageView::drawTiles(DrawBase& signal) {
+
+	const util::box<float,3>& bb = _image->getBoundingBox();
+	unsigned int tileSize  = _tileCache->getTileSize();
+	unsigned int numLevels = _pyramid->getNumLevels();
+
+	// the size of a pixel of level 0 in units
+	float pixelWidth  = bb.width()/_image->width();
+	float pixelHeight = bb.height()/_image->height();
+
+	// the coarsest level whose pixels are not larger than a screen pixel
+	float screenPixelsPerPixel = std::max(
+			signal.resolution().x()*pixelWidth,
+			signal.resolution().y()*pixelHeight);
+
+	unsigned int level = numLevels - 1;
+	if (screenPixelsPerPixel > 0) {
+
+		level = 0;
+		while (level + 1 < numLevels && (1 << (level + 1))*screenPixelsPerPixel <= 1)
+			level++;
+	}
+
+	// the visible part of the image in pixels of level 0
+	const util::box<float,2>& roi = signal.roi();
+	float minX = std::max(0.0f, (roi.min().x() - bb.min().x())/pixelWidth);
+	float minY = std::max(0.0f, (roi.min().y() - bb.min().y())/pixelHeight);
+	float maxX = std::min(static_cast<float>(_image->width()),  (roi.max().x() - bb.min().x())/pixelWidth);
+	float maxY = std::min(static_cast<float>(_image->height()), (roi.max().y() - bb.min().y())/pixelHeight);
+
+	if (minX >= maxX || minY >= maxY)
+		return;
+
+	unsigned int numUploads = 0;
+	unsigned int numMissing = 0;
+
+	// the coarsest level fits into one tile, keep it to have something to 
+	// show for every tile that is not uploaded yet
+	if (!_coarsestTile) {
+
+		_coarsestTile = TexturePool::get(tileSize, tileSize, _shaderColors ? GL_R32F : GL_RGBA);
+		loadTile(TextureTileCache::Key(numLevels - 1, 0, 0), *_coarsestTile);
+		numUploads++;
+	}
+
+	auto getTile = [this, numLevels](const TextureTileCache::Key& key) {
+
+		return (key.level == numLevels - 1 ? _coarsestTile.get() : _tileCache->get(key));
+	};
+
+	// the size of a tile in pixels of level 0
+	float scaledTileSize = static_cast<float>(tileSize << level);
+
+	unsigned int beginX = minX/scaledTileSize;
+	unsigned int beginY = minY/scaledTileSize;
+	unsigned int endX   = std::ceil(maxX/scaledTileSize);
+	unsigned int endY   = std::ceil(maxY/scaledTileSize);
+
+	for (unsigned int y = beginY; y < endY; y++)
+		for (unsigned int x = beginX; x < endX; x++) {
+
+			TextureTileCache::Key key(level, x, y);
+
+			// the region of this tile in pixels of level 0
+			float tileMinX = x*scaledTileSize;
+			float tileMinY = y*scaledTileSize;
+			float tileMaxX = std::min(static_cast<float>(_image->width()),  tileMinX + scaledTileSize);
+			float tileMaxY = std::min(static_cast<float>(_image->height()), tileMinY + scaledTileSize);
+
+			Texture* texture = getTile(key);
+
+			if (!texture && numUploads < MaxTileUploadsPerFrame) {
+
+				texture = _tileCache->insert(key);
+				loadTile(key, *texture);
+				numUploads++;
+			}
+
+			if (texture) {
+
+				drawTile(key, *texture, tileMinX, tileMinY, tileMaxX, tileMaxY);
+				continue;
+			}
+
+			numMissing++;
+
+			// show the closest coarser tile that is cached
+			for (unsigned int l = level + 1; l < numLevels; l++) {
+
+				TextureTileCache::Key parent(l, x >> (l - level), y >> (l - level));
+
+				if (Texture* parentTexture = getTile(parent)) {
+
+					drawTile(parent, *parentTexture, tileMinX, tileMinY, tileMaxX, tileMaxY);
+					break;
+				}
+			}
+		}
+
+	LOG_ALL(imageviewlog)
+			<< "drew level " << level << ", uploaded " << numUploads
+			<< " tiles, " << numMissing << " missing" << std::endl;
+
+	// come back for the missing tiles
+	if (numMissing > 0)
+		signal.setNeedsRedraw();
+}
+
+void
+ImageView::loadTile(const TextureTileCache::Key& key, Texture& texture) {
+
+	unsigned int tileSize = _tileCache->getTileSize();
+	unsigned int width    = _pyramid->width(key.level);
+	unsigned int x0       = key.x*tileSize;
+	unsigned int y0       = key.y*tileSize;
+	unsigned int w        = std::min(tileSize, width - x0);
+	unsigned int h        = std::min(tileSize, _pyramid->height(key.level) - y0);
+
+	const float* data = _pyramid->data(key.level);
+	util::box<unsigned int,2> region(0, 0, w, h);
+
+	if (_labelImage && !_shaderColors) {
+
+		std::vector<boost::array<unsigned char, 4> > colorTile(w*h);
+
+		for (unsigned int y = 0; y < h; y++)
+			toRgba(data + static_cast<std::size_t>(y0 + y)*width + x0, w, &colorTile[y*w]);
+
+		texture.loadData(&colorTile[0], region);
 
 	} else {
 
-		// non-intensity images are just loaded
-		_texture->loadData(&(*_image->begin()));
+		std::vector<float> tile(w*h);
+
+		for (unsigned int y = 0; y < h; y++)
+			if (!_shaderColors && !_labelImage)
+				applyWindow(data + static_cast<std::size_t>(y0 + y)*width + x0, w, &tile[y*w]);
+			else
+				std::copy_n(data + static_cast<std::size_t>(y0 + y)*width + x0, w, &tile[y*w]);
+
+		texture.loadData(&tile[0], region);
 	}
+}
 
-	_needReload = false;
+void
+ImageView::drawTile(
+		const TextureTileCache::Key& key,
+		Texture&                     texture,
+		float                        minX,
+		float                        minY,
+		float                        maxX,
+		float                        maxY) {
+
+	const util::box<float,3>& bb = _image->getBoundingBox();
+
+	float pixelWidth  = bb.width()/_image->width();
+	float pixelHeight = bb.height()/_image->height();
+	float z           = bb.min().z();
+
+	// texture coordinates of the region, in the tile of level key.level
+	float scaledTileSize = static_cast<float>(_tileCache->getTileSize() << key.level);
+	float texMinX = minX/scaledTileSize - key.x;
+	float texMinY = minY/scaledTileSize - key.y;
+	float texMaxX = maxX/scaledTileSize - key.x;
+	float texMaxY = maxY/scaledTileSize - key.y;
+
+	minX = bb.min().x() + minX*pixelWidth;
+	minY = bb.min().y() + minY*pixelHeight;
+	maxX = bb.min().x() + maxX*pixelWidth;
+	maxY = bb.min().y() + maxY*pixelHeight;
+
+	texture.bind();
+
+	glBegin(GL_QUADS);
+	glTexCoord2d(texMinX, texMaxY); glVertex3d(minX, maxY, z);
+	glTexCoord2d(texMaxX, texMaxY); glVertex3d(maxX, maxY, z);
+	glTexCoord2d(texMaxX, texMinY); glVertex3d(maxX, minY, z);
+	glTexCoord2d(texMinX, texMinY); glVertex3d(minX, minY, z);
+	glEnd();
+
+	texture.unbind();
+}
+
+void
+ImageView::applyWindow(const float* values, std::size_t n, float* windowed) const {
+
+	if (isIdentityWindow()) {
+
+		std::copy_n(values, n, windowed);
+		return;
+	}
+
+	for (std::size_t i = 0; i < n; i++) {
+
+		float intensity = std::min(std::max(values[i]*_scale + _bias, 0.0f), 1.0f);
+
+		windowed[i] = (_gamma == 1.0f ? intensity : std::pow(intensity, _gamma));
+	}
+}
+
+bool
+ImageView::isShaderSupported() {
+
+	// GLSL 1.30 for unsigned integers, single channel float textures
+	return GLEW_VERSION_3_0;
 }
 
 } // namespace sg_gui
@@ -1,9 +1,18 @@
 #ifndef SG_GUI_IMAGE_VIEW_H__
 #define SG_GUI_IMAGE_VIEW_H__
 
+#include <memory>
+#include <vector>
+#include <boost/array.hpp>
 #include <scopegraph/Agent.h>
 #include <imageprocessing/Image.h>
+#include "ImagePyramid.h"
+#include "ImageStatistics.h"
+#include "ShaderProgram.h"
 #include "Texture.h"
+#include "TexturePool.h"
+#include "TextureTileCache.h"
+#include "TextureUploader.h"
 #include "GuiSignals.h"
 #include "MouseSignals.h"
 #include "ViewSignals.h"
@@ -16,16 +25,117 @@ public:
 
 	typedef SetContent parent_type;
 
-	SetImage(std::shared_ptr<Image> image) :
-		_image(image) {}
+	/**
+	 * Set a new image, optionally with precomputed statistics (e.g., of the 
+	 * volume the image is a section of). Without, they are computed by the 
+	 * receiver when needed.
+	 */
+	SetImage(
+			std::shared_ptr<Image> image,
+			std::shared_ptr<const ImageStatistics> statistics = std::shared_ptr<const ImageStatistics>()) :
+		_image(image),
+		_statistics(statistics) {}
 
 	std::shared_ptr<Image> getImage() { return _image; }
 
+	std::shared_ptr<const ImageStatistics> getStatistics() { return _statistics; }
+
 private:
 
 	std::shared_ptr<Image> _image;
+
+	std::shared_ptr<const ImageStatistics> _statistics;
+};
+
+/**
+ * Indicates that the pixels of the current image changed within a region (in 
+ * pixels), e.g., after painting into a label image.
+ */
+class ImageRegionChanged : public SetContent {
+
+public:
+
+	typedef SetContent parent_type;
+
+	ImageRegionChanged(const util::box<unsigned int,2>& region) :
+		_region(region) {}
+
+	const util::box<unsigned int,2>& getRegion() const { return _region; }
+
+private:
+
+	util::box<unsigned int,2> _region;
+};
+
+/**
+ * Sets the intensity window of intensity images: values are shown as 
+ * clamp(value*scale + bias, 0, 1)^gamma.
+ */
+class ChangeIntensityWindow : public GuiSignal {
+
+public:
+
+	typedef GuiSignal parent_type;
+
+	ChangeIntensityWindow(float scale, float bias, float gamma = 1.0f) :
+		_scale(scale),
+		_bias(bias),
+		_gamma(gamma) {}
+
+	float getScale() const { return _scale; }
+	float getBias()  const { return _bias; }
+	float getGamma() const { return _gamma; }
+
+private:
+
+	float _scale;
+	float _bias;
+	float _gamma;
+};
+
+/**
+ * Sets a color lookup table for windowed intensities, from 0 (first entry) to 
+ * 1 (last entry). An empty table shows intensities as gray values.
+ */
+class SetLookupTable : public GuiSignal {
+
+public:
+
+	typedef GuiSignal parent_type;
+
+	SetLookupTable(const std::vector<boost::array<unsigned char, 4> >& lut) :
+		_lut(lut) {}
+
+	const std::vector<boost::array<unsigned char, 4> >& getLookupTable() const { return _lut; }
+
+private:
+
+	std::vector<boost::array<unsigned char, 4> > _lut;
 };
 
+/**
+ * Shows an image as a textured quad in its bounding box.
+ *
+ * Images larger than the maximal texture size (or all images, with 
+ * --tiledImages) are shown tiled: tiles of a multi-resolution pyramid are 
+ * uploaded on demand for the visible region at a level matching the 
+ * resolution of the draw signal, and kept in an LRU cache.
+ *
+ * Whole images are streamed into their texture through a ring of pixel 
+ * buffers, such that switching between images of the same size (e.g., 
+ * sections of a volume) does not stall on the GPU.
+ *
+ * With --mipmapImages, untiled images get mipmaps for zoomed-out views.
+ *
+ * Changes to parts of the image (see updateRegion()) are collected and only 
+ * the bounding box of all of them is uploaded at the next draw. For tiled 
+ * images, only the pyramid pixels and cached tiles under it are updated.
+ *
+ * If supported, images are uploaded as they are into single channel float 
+ * textures and colored in a fragment shader: label ids (values above one) with 
+ * the same colors as idToRgb(), intensities through the intensity window and 
+ * lookup table. Changing those does not need another upload.
+ */
 class ImageView :
 		public sg::Agent<
 				ImageView,
@@ -34,6 +144,9 @@ class ImageView :
 						DrawTranslucent,
 						QuerySize,
 						SetImage,
+						ImageRegionChanged,
+						ChangeIntensityWindow,
+						SetLookupTable,
 						ChangeAlpha
 				>,
 				sg::Provides<
@@ -44,9 +157,15 @@ class ImageView :
 public:
 
 	ImageView() :
-		_texture(0),
 		_red(1.0), _green(1.0), _blue(1.0),
 		_needReload(true),
+		_dirty(false),
+		_labelImage(false),
+		_tiled(false),
+		_shaderColors(false),
+		_scale(1.0f), _bias(0.0f), _gamma(1.0f),
+		_lutTexture(0),
+		_lutChanged(false),
 		_alpha(1.0) {}
 
 	~ImageView();
@@ -58,25 +177,154 @@ public:
 
 	void onSignal(SetImage& signal);
 
+	void onSignal(ImageRegionChanged& signal);
+
+	void onSignal(ChangeIntensityWindow& signal);
+
+	void onSignal(SetLookupTable& signal);
+
 	void onSignal(ChangeAlpha& signal);
 
 	std::shared_ptr<Image> getImage() { return _image; }
 
+	/**
+	 * Notify this view that the pixels of the current image changed within 
+	 * the given region (in pixels). Only the changed part will be uploaded.
+	 */
+	void updateRegion(const util::box<unsigned int,2>& region);
+
 private:
 
 	void loadTexture();
 
-	void draw();
+	/**
+	 * Get the statistics of the current image, computes them if needed.
+	 */
+	const ImageStatistics& getStatistics();
+
+	/**
+	 * Upload the dirty region of the image into _texture, or into the pyramid 
+	 * and tiles.
+	 */
+	void loadRegion();
+
+	/**
+	 * Recompute the pyramid under the dirty region and reload the cached 
+	 * tiles that intersect it.
+	 */
+	void updateTiles();
+
+	/**
+	 * Fill the mipmap levels of _texture, by averaging intensities on the GPU 
+	 * or with the most frequent label of each 2x2 block for label images.
+	 */
+	void loadMipmaps();
+
+	/**
+	 * Check whether label images of the current context can be colored on the 
+	 * GPU.
+	 */
+	static bool isShaderSupported();
+
+	/**
+	 * Bind and configure _shader for the current image.
+	 */
+	void bindShader();
+
+	/**
+	 * Apply the intensity window to intensities on the CPU, for when there is 
+	 * no shader.
+	 */
+	void applyWindow(const float* values, std::size_t n, float* windowed) const;
+
+	bool isIdentityWindow() const { return _scale == 1.0f && _bias == 0.0f && _gamma == 1.0f; }
+
+	/**
+	 * Create the pyramid and tile cache for tiled drawing.
+	 */
+	void loadPyramid();
+
+	void draw(DrawBase& signal);
+
+	/**
+	 * Draw the whole image from _texture.
+	 */
+	void drawTexture();
+
+	/**
+	 * Draw the tiles of the pyramid level matching the signal's resolution 
+	 * within its ROI. Uploads missing tiles, at most MaxTileUploadsPerFrame 
+	 * of them, and shows coarser cached tiles in place of the others.
+	 */
+	void drawTiles(DrawBase& signal);
+
+	/**
+	 * Fill the texture with the content of a tile of the pyramid.
+	 */
+	void loadTile(const TextureTileCache::Key& key, Texture& texture);
+
+	/**
+	 * Draw the part of a cached tile that covers the given region of the 
+	 * image (in pixels of level 0).
+	 */
+	void drawTile(
+			const TextureTileCache::Key& key,
+			Texture&                     texture,
+			float                        minX,
+			float                        minY,
+			float                        maxX,
+			float                        maxY);
+
+	// the number of tiles to upload at most while drawing one frame
+	static const unsigned int MaxTileUploadsPerFrame = 16;
 
 	std::shared_ptr<Image> _image;
 
-	Texture* _texture;
+	// statistics of _image, reset when it changes
+	std::shared_ptr<const ImageStatistics> _statistics;
+
+	// the texture of untiled images, from the TexturePool
+	std::shared_ptr<Texture> _texture;
+
+	// streams images into _texture through pixel buffers
+	std::unique_ptr<TextureUploader> _uploader;
 
 	// colorization of intensity images
 	float _red, _green, _blue;
 
 	bool _needReload;
 
+	// the bounding box of all changed pixels since the last upload, valid if 
+	// _dirty is set
+	bool _dirty;
+	util::box<unsigned int,2> _dirtyRegion;
+
+	// the image contains values above one
+	bool _labelImage;
+
+	// draw from a pyramid of tiles instead of _texture
+	bool _tiled;
+
+	std::unique_ptr<ImagePyramid>     _pyramid;
+	std::unique_ptr<TextureTileCache> _tileCache;
+
+	// the single tile of the coarsest level, kept outside of the cache such 
+	// that it is never evicted
+	std::shared_ptr<Texture> _coarsestTile;
+
+	// the textures contain raw values to be colored by _shader
+	bool _shaderColors;
+
+	std::unique_ptr<ShaderProgram> _shader;
+
+	// the intensity window
+	float _scale, _bias, _gamma;
+
+	// the color lookup table for intensities and its 1D texture
+	std::vector<boost::array<unsigned char, 4> > _lut;
+	GLuint _lutTexture;
+	bool   _lutChanged;
+
 	float _alpha;
 };
 
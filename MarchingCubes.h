@@ -976,29 +976,35 @@ void MarchingCubes<Volume>::CalculateNormals()
 		_mesh->setNormal(i, Vector3d(0, 0, 0));
 
 	// Calculate normals.
+	const unsigned int* indices = _mesh->getIndexData();
+	float* normals = _mesh->getNormalData();
 	for (unsigned int i = 0; i < _nTriangles; i++) {
 		Vector3d vec1, vec2, normal;
 		unsigned int id0, id1, id2;
-		id0 = _mesh->getTriangle(i).v0;
-		id1 = _mesh->getTriangle(i).v1;
-		id2 = _mesh->getTriangle(i).v2;
+		id0 = indices[3*i];
+		id1 = indices[3*i + 1];
+		id2 = indices[3*i + 2];
 		vec1 = _mesh->getVertex(id1) - _mesh->getVertex(id0);
 		vec2 = _mesh->getVertex(id2) - _mesh->getVertex(id0);
 		normal.x() = vec1.z()*vec2.y() - vec1.y()*vec2.z();
 		normal.y() = vec1.x()*vec2.z() - vec1.z()*vec2.x();
 		normal.z() = vec1.y()*vec2.x() - vec1.x()*vec2.y();
-		_mesh->getNormal(id0) += normal;
-		_mesh->getNormal(id1) += normal;
-		_mesh->getNormal(id2) += normal;
+		for (unsigned int id : { id0, id1, id2 }) {
+			normals[3*id]     += normal.x();
+			normals[3*id + 1] += normal.y();
+			normals[3*id + 2] += normal.z();
+		}
 	}
 
 	// Normalize normals.
-	for (unsigned int i = 0; i < _nNormals; i++) {
+	for (unsigned int i = 0; i < 3*_nNormals; i += 3) {
 		float length = sqrt(
-				_mesh->getNormal(i).x()*_mesh->getNormal(i).x() +
-				_mesh->getNormal(i).y()*_mesh->getNormal(i).y() +
-				_mesh->getNormal(i).z()*_mesh->getNormal(i).z());
-		_mesh->getNormal(i) /= length;
+				normals[i]*normals[i] +
+				normals[i + 1]*normals[i + 1] +
+				normals[i + 2]*normals[i + 2]);
+		normals[i]     /= length;
+		normals[i + 1] /= length;
+		normals[i + 2] /= length;
 	}
 }
 
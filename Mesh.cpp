@@ -1,73 +1,617 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <sstream>
+#include <thread>
 #include "Mesh.h"
 
 namespace sg_gui {
 
+namespace {
+
+bool isLittleEndian() {
+
+	uint16_t one = 1;
+	return *reinterpret_cast<unsigned char*>(&one) == 1;
+}
+
+/**
+ * Collects small writes in a buffer and passes them on to the stream in 
+ * large chunks.
+ */
+class BufferedWriter {
+
+public:
+
+	BufferedWriter(std::ostream& out, bool swapBytes = false) :
+		_out(out),
+		_swapBytes(swapBytes),
+		_size(0) {}
+
+	~BufferedWriter() { flush(); }
+
+	template <typename T>
+	void write(const T& value) {
+
+		if (_size + sizeof(T) > BufferSize)
+			flush();
+
+		std::memcpy(_buffer + _size, &value, sizeof(T));
+
+		if (_swapBytes)
+			std::reverse(_buffer + _size, _buffer + _size + sizeof(T));
+
+		_size += sizeof(T);
+	}
+
+	void write(const char* data, std::size_t size) {
+
+		if (_size + size > BufferSize)
+			flush();
+
+		if (size > BufferSize) {
+
+			_out.write(data, size);
+			return;
+		}
+
+		std::memcpy(_buffer + _size, data, size);
+		_size += size;
+	}
+
+	template <typename ... Args>
+	void printf(const char* format, Args ... args) {
+
+		// enough for a line of three floats or integers
+		if (_size + MaxLineSize > BufferSize)
+			flush();
+
+		_size += std::snprintf(_buffer + _size, MaxLineSize, format, args...);
+	}
+
+	void flush() {
+
+		_out.write(_buffer, _size);
+		_size = 0;
+	}
+
+private:
+
+	static const std::size_t BufferSize  = 1 << 16;
+	static const std::size_t MaxLineSize = 128;
+
+	std::ostream& _out;
+
+	bool _swapBytes;
+
+	char _buffer[BufferSize];
+
+	std::size_t _size;
+};
+
+} // anonymous namespace
+
+const unsigned int Mesh::Components;
+const std::size_t  Mesh::PositionStride;
+const std::size_t  Mesh::NormalStride;
+const std::size_t  Mesh::TriangleStride;
+const unsigned int Mesh::NoVertex;
+
+util::box<float,3>
+Mesh::computeBoundingBox() const {
+
+	if (_positions.empty())
+		return util::box<float,3>();
+
+	float min[3] = { _positions[0], _positions[1], _positions[2] };
+	float max[3] = { _positions[0], _positions[1], _positions[2] };
+
+	// one pass over the packed positions
+	for (std::size_t i = Components; i < _positions.size(); i += Components)
+		for (unsigned int d = 0; d < Components; d++) {
+
+			min[d] = std::min(min[d], _positions[i + d]);
+			max[d] = std::max(max[d], _positions[i + d]);
+		}
+
+	return util::box<float,3>(
+			Point3d(min[0], min[1], min[2]),
+			Point3d(max[0], max[1], max[2]));
+}
+
+void
+Mesh::optimizeVertexCache(unsigned int cacheSize) {
+
+	unsigned int numTriangles = getNumTriangles();
+	unsigned int numVertices  = getNumVertices();
+
+	if (numTriangles == 0)
+		return;
+
+	std::vector<unsigned int> order = getVertexCacheOrder(cacheSize);
+
+	// renumber the vertices in the order of their first use
+	std::vector<unsigned int> remap(numVertices, NoVertex);
+	std::vector<unsigned int> used;
+	used.reserve(numVertices);
+
+	std::vector<unsigned int> indices(_indices.size());
+	unsigned int* index = indices.data();
+
+	for (unsigned int triangle : order)
+		for (unsigned int i = 0; i < 3; i++) {
+
+			unsigned int v = _indices[3*triangle + i];
+
+			if (remap[v] == NoVertex) {
+
+				remap[v] = used.size();
+				used.push_back(v);
+			}
+
+			*index++ = remap[v];
+		}
+
+	for (unsigned int v = 0; v < numVertices; v++)
+		if (remap[v] == NoVertex)
+			used.push_back(v);
+
+	std::vector<float> positions(_positions.size());
+	std::vector<float> normals(_normals.size());
+
+	for (unsigned int i = 0; i < numVertices; i++) {
+
+		std::copy_n(&_positions[Components*used[i]], Components, &positions[Components*i]);
+		std::copy_n(&_normals[Components*used[i]],   Components, &normals[Components*i]);
+	}
+
+	_positions.swap(positions);
+	_normals.swap(normals);
+	_indices.swap(indices);
+
+	_bvh.reset();
+}
+
+std::vector<unsigned int>
+Mesh::getVertexCacheOrder(unsigned int cacheSize) const {
+
+	const float CacheDecayPower   = 1.5f;
+	const float LastTriangleScore = 0.75f;
+	const float ValenceBoostScale = 2.0f;
+	const float ValenceBoostPower = 0.5f;
+
+	cacheSize = std::max(cacheSize, 4u);
+
+	unsigned int numTriangles = getNumTriangles();
+	unsigned int numVertices  = getNumVertices();
+
+	// the triangles of each vertex, the first remaining[v] of them are not 
+	// drawn yet
+	std::vector<unsigned int> offsets(numVertices + 1, 0);
+	for (unsigned int index : _indices)
+		offsets[index + 1]++;
+	for (unsigned int v = 0; v < numVertices; v++)
+		offsets[v + 1] += offsets[v];
+
+	std::vector<unsigned int> remaining(numVertices, 0);
+	std::vector<unsigned int> adjacent(_indices.size());
+	for (unsigned int i = 0; i < _indices.size(); i++) {
+
+		unsigned int v = _indices[i];
+		adjacent[offsets[v] + remaining[v]++] = i/3;
+	}
+
+	// the score of a vertex depends on its position in the cache and the 
+	// number of triangles that still use it
+	std::vector<float> cacheScores(cacheSize);
+	for (unsigned int i = 0; i < cacheSize; i++)
+		cacheScores[i] = (i < 3 ?
+				LastTriangleScore :
+				std::pow(1.0f - static_cast<float>(i - 3)/(cacheSize - 3), CacheDecayPower));
+
+	std::vector<float> valenceScores(64);
+	for (unsigned int i = 1; i < valenceScores.size(); i++)
+		valenceScores[i] = ValenceBoostScale*std::pow(static_cast<float>(i), -ValenceBoostPower);
+
+	auto vertexScore = [&](int cachePosition, unsigned int valence) {
+
+		if (valence == 0)
+			return -1.0f;
+
+		float score = (cachePosition >= 0 ? cacheScores[cachePosition] : 0.0f);
+
+		return score + (valence < valenceScores.size() ?
+				valenceScores[valence] :
+				ValenceBoostScale*std::pow(static_cast<float>(valence), -ValenceBoostPower));
+	};
+
+	std::vector<int>   cachePositions(numVertices, -1);
+	std::vector<float> vertexScores(numVertices);
+	for (unsigned int v = 0; v < numVertices; v++)
+		vertexScores[v] = vertexScore(-1, remaining[v]);
+
+	std::vector<float> triangleScores(numTriangles);
+	std::vector<bool>  drawn(numTriangles, false);
+	for (unsigned int t = 0; t < numTriangles; t++)
+		triangleScores[t] =
+				vertexScores[_indices[3*t]] +
+				vertexScores[_indices[3*t + 1]] +
+				vertexScores[_indices[3*t + 2]];
+
+	std::vector<unsigned int> order;
+	order.reserve(numTriangles);
+
+	// the simulated cache, with room for the vertices pushed out by the next 
+	// triangle
+	std::vector<unsigned int> cache;
+	std::vector<unsigned int> nextCache;
+	cache.reserve(cacheSize + 3);
+	nextCache.reserve(cacheSize + 3);
+
+	// the next triangle to start from if none in the cache is left
+	unsigned int cursor = 0;
+
+	int best = -1;
+	for (unsigned int t = 0; t < numTriangles; t++)
+		if (best < 0 || triangleScores[t] > triangleScores[best])
+			best = t;
+
+	while (best >= 0) {
+
+		drawn[best] = true;
+		order.push_back(best);
+
+		nextCache.clear();
+
+		for (unsigned int i = 0; i < 3; i++) {
+
+			unsigned int v = _indices[3*best + i];
+
+			// remove the triangle from the remaining ones of v
+			unsigned int* begin = &adjacent[offsets[v]];
+			unsigned int* end   = begin + remaining[v];
+			std::swap(*std::find(begin, end, static_cast<unsigned int>(best)), *(end - 1));
+			remaining[v]--;
+
+			// degenerate triangles use a vertex twice
+			if (cachePositions[v] != -2) {
+
+				nextCache.push_back(v);
+				cachePositions[v] = -2;
+			}
+		}
+
+		for (unsigned int v : cache)
+			if (cachePositions[v] != -2)
+				nextCache.push_back(v);
+
+		cache.swap(nextCache);
+
+		// update the scores of all vertices that were or are in the cache
+		for (unsigned int i = 0; i < cache.size(); i++) {
+
+			unsigned int v = cache[i];
+
+			cachePositions[v] = (i < cacheSize ? static_cast<int>(i) : -1);
+			vertexScores[v]   = vertexScore(cachePositions[v], remaining[v]);
+		}
+
+		// find the best triangle among the ones using cached vertices
+		best = -1;
+		for (unsigned int v : cache)
+			for (unsigned int j = offsets[v]; j < offsets[v] + remaining[v]; j++) {
+
+				unsigned int t = adjacent[j];
+
+				triangleScores[t] =
+						vertexScores[_indices[3*t]] +
+						vertexScores[_indices[3*t + 1]] +
+						vertexScores[_indices[3*t + 2]];
+
+				if (best < 0 || triangleScores[t] > triangleScores[best])
+					best = t;
+			}
+
+		if (cache.size() > cacheSize)
+			cache.resize(cacheSize);
+
+		// start over somewhere else
+		if (best < 0) {
+
+			while (cursor < numTriangles && drawn[cursor])
+				cursor++;
+
+			if (cursor < numTriangles)
+				best = cursor;
+		}
+	}
+
+	return order;
+}
+
+void
+Mesh::buildBvh() {
+
+	std::vector<float> bounds(6*getNumTriangles());
+
+	for (unsigned int i = 0; i < getNumTriangles(); i++) {
+
+		const float* p0 = &_positions[Components*_indices[3*i    ]];
+		const float* p1 = &_positions[Components*_indices[3*i + 1]];
+		const float* p2 = &_positions[Components*_indices[3*i + 2]];
+
+		for (int d = 0; d < 3; d++) {
+
+			bounds[6*i + d]     = std::min({p0[d], p1[d], p2[d]});
+			bounds[6*i + 3 + d] = std::max({p0[d], p1[d], p2[d]});
+		}
+	}
+
+	std::shared_ptr<Bvh> bvh = std::make_shared<Bvh>();
+	bvh->build(bounds);
+
+	_bvh = bvh;
+}
+
+bool
+Mesh::intersect(const util::ray<float,3>& ray, float& t, unsigned int& triangle) const {
+
+	if (_bvh)
+		return _bvh->intersect(
+				ray,
+				t,
+				triangle,
+				[this, &ray](unsigned int i, float& ti) { return intersectTriangle(ray, i, ti); });
+
+	bool hit = false;
+	t = std::numeric_limits<float>::max();
+
+	for (unsigned int i = 0; i < getNumTriangles(); i++) {
+
+		float ti;
+		if (intersectTriangle(ray, i, ti) && ti < t) {
+
+			t = ti;
+			triangle = i;
+			hit = true;
+		}
+	}
+
+	return hit;
+}
+
+bool
+Mesh::intersectTriangle(const util::ray<float,3>& ray, unsigned int triangle, float& t) const {
+
+	const float* p0 = &_positions[Components*_indices[3*triangle    ]];
+	const float* p1 = &_positions[Components*_indices[3*triangle + 1]];
+	const float* p2 = &_positions[Components*_indices[3*triangle + 2]];
+
+	const float o[3] = { ray.position().x(),  ray.position().y(),  ray.position().z()  };
+	const float d[3] = { ray.direction().x(), ray.direction().y(), ray.direction().z() };
+
+	const float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+	const float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+
+	// p = d x e2
+	const float p[3] = {
+			d[1]*e2[2] - d[2]*e2[1],
+			d[2]*e2[0] - d[0]*e2[2],
+			d[0]*e2[1] - d[1]*e2[0] };
+
+	float det = e1[0]*p[0] + e1[1]*p[1] + e1[2]*p[2];
+
+	// ray parallel to triangle
+	if (std::abs(det) < std::numeric_limits<float>::epsilon())
+		return false;
+
+	float inverseDet = 1.0f/det;
+
+	const float s[3] = { o[0] - p0[0], o[1] - p0[1], o[2] - p0[2] };
+
+	float u = (s[0]*p[0] + s[1]*p[1] + s[2]*p[2])*inverseDet;
+	if (u < 0 || u > 1)
+		return false;
+
+	// q = s x e1
+	const float q[3] = {
+			s[1]*e1[2] - s[2]*e1[1],
+			s[2]*e1[0] - s[0]*e1[2],
+			s[0]*e1[1] - s[1]*e1[0] };
+
+	float v = (d[0]*q[0] + d[1]*q[1] + d[2]*q[2])*inverseDet;
+	if (v < 0 || u + v > 1)
+		return false;
+
+	t = (e2[0]*q[0] + e2[1]*q[1] + e2[2]*q[2])*inverseDet;
+
+	return t >= 0;
+}
+
 Mesh
-Mesh::createSubmesh(const std::vector<unsigned int>& triangles) {
+Mesh::createSubmesh(const std::vector<unsigned int>& triangles) const {
 
 	Mesh submesh;
+	std::vector<unsigned int> remap(getNumVertices(), NoVertex);
+
+	extractSubmesh(triangles, remap, submesh);
+
+	return submesh;
+}
 
-	submesh._vertices = _vertices;
-	submesh._normals  = _normals;
+std::vector<Mesh>
+Mesh::createSubmeshes(
+		const std::vector<std::vector<unsigned int>>& triangles,
+		unsigned int numThreads) const {
 
-	submesh._triangles.reserve(triangles.size());
+	std::vector<Mesh> submeshes(triangles.size());
 
-	foreach (unsigned int triangle, triangles)
-		submesh._triangles.push_back(_triangles[triangle]);
+	if (numThreads == 0)
+		numThreads = std::max(1u, std::thread::hardware_concurrency());
+	numThreads = std::min(numThreads, static_cast<unsigned int>(triangles.size()));
 
-	submesh.strip();
+	// the next submesh to extract
+	std::atomic<std::size_t> next(0);
 
-	return submesh;
+	auto work = [&]() {
+
+		// one remap table per thread, reused for all its submeshes
+		std::vector<unsigned int> remap(getNumVertices(), NoVertex);
+
+		for (std::size_t i = next++; i < triangles.size(); i = next++)
+			extractSubmesh(triangles[i], remap, submeshes[i]);
+	};
+
+	std::vector<std::thread> threads;
+	for (unsigned int i = 1; i < numThreads; i++)
+		threads.emplace_back(work);
+
+	work();
+
+	for (std::thread& thread : threads)
+		thread.join();
+
+	return submeshes;
 }
 
 void
-Mesh::strip() {
+Mesh::extractSubmesh(
+		const std::vector<unsigned int>& triangles,
+		std::vector<unsigned int>&       remap,
+		Mesh&                            submesh) const {
 
-	std::vector<unsigned int> vertexTag(getNumVertices(), std::numeric_limits<unsigned int>::max());
+	// the used vertices of this mesh, in the order of their new indices
+	std::vector<unsigned int> used;
+	used.reserve(triangles.size());
 
-	// tag all used vertices with 0
+	submesh._indices.resize(3*triangles.size());
+	unsigned int* indices = submesh._indices.data();
+
+	for (unsigned int triangle : triangles)
+		for (unsigned int i = 0; i < 3; i++) {
+
+			unsigned int v = _indices[3*triangle + i];
+
+			if (remap[v] == NoVertex) {
+
+				remap[v] = used.size();
+				used.push_back(v);
+			}
+
+			*indices++ = remap[v];
+		}
 
-	foreach (const Triangle& triangle, _triangles) {
+	submesh.setNumVertices(used.size());
 
-		vertexTag[triangle.v0] = 0;
-		vertexTag[triangle.v1] = 0;
-		vertexTag[triangle.v2] = 0;
+	float* positions = submesh._positions.data();
+	float* normals   = submesh._normals.data();
+
+	for (unsigned int v : used) {
+
+		positions = std::copy_n(&_positions[Components*v], Components, positions);
+		normals   = std::copy_n(&_normals[Components*v],   Components, normals);
+
+		// leave the remap table clean for the next submesh
+		remap[v] = NoVertex;
 	}
+}
+
+void
+Mesh::writePly(std::ostream& out) const {
 
-	// create a vector of the used vertices (and normals)
+	std::stringstream header;
+	header
+			<< "ply" << std::endl
+			<< "format " << (isLittleEndian() ? "binary_little_endian" : "binary_big_endian") << " 1.0" << std::endl
+			<< "element vertex " << getNumVertices() << std::endl
+			<< "property float x" << std::endl
+			<< "property float y" << std::endl
+			<< "property float z" << std::endl
+			<< "property float nx" << std::endl
+			<< "property float ny" << std::endl
+			<< "property float nz" << std::endl
+			<< "element face " << getNumTriangles() << std::endl
+			<< "property list uchar uint vertex_indices" << std::endl
+			<< "end_header" << std::endl;
 
-	std::vector<Point3d>  usedVertices;
-	std::vector<Vector3d> usedNormals;
+	BufferedWriter writer(out);
+
+	std::string h = header.str();
+	writer.write(h.c_str(), h.size());
 
-	unsigned int newIndex = 0;
 	for (unsigned int i = 0; i < getNumVertices(); i++) {
 
-		if (vertexTag[i] == 0) { // vertex is used
+		writer.write(reinterpret_cast<const char*>(&_positions[Components*i]), PositionStride);
+		writer.write(reinterpret_cast<const char*>(&_normals[Components*i]), NormalStride);
+	}
 
-			// keep the vertex
+	const unsigned char three = 3;
+	for (unsigned int i = 0; i < getNumTriangles(); i++) {
 
-			usedVertices.push_back(_vertices[i]);
-			usedNormals.push_back(_normals[i]);
+		writer.write(three);
+		writer.write(reinterpret_cast<const char*>(&_indices[3*i]), TriangleStride);
+	}
+}
 
-			// tag the vertex with the new index in the reduced vector
+void
+Mesh::writeStl(std::ostream& out) const {
 
-			vertexTag[i] = newIndex;
-			newIndex++;
-		}
+	// STL is always little endian
+	BufferedWriter writer(out, !isLittleEndian());
+
+	char header[80];
+	std::memset(header, 0, 80);
+	std::strncpy(header, "binary STL written by sg_gui", 80);
+	writer.write(header, 80);
+
+	writer.write(static_cast<uint32_t>(getNumTriangles()));
+
+	const uint16_t attributes = 0;
+	for (unsigned int i = 0; i < getNumTriangles(); i++) {
+
+		Triangle triangle = getTriangle(i);
+
+		// the face normal, as the average of the vertex normals
+		Vector3d normal = getNormal(triangle.v0) + getNormal(triangle.v1) + getNormal(triangle.v2);
+		float length = std::sqrt(normal.x()*normal.x() + normal.y()*normal.y() + normal.z()*normal.z());
+		if (length > 0)
+			normal /= length;
+
+		writer.write(normal.x());
+		writer.write(normal.y());
+		writer.write(normal.z());
+
+		for (unsigned int v : { triangle.v0, triangle.v1, triangle.v2 })
+			for (unsigned int c = 0; c < Components; c++)
+				writer.write(_positions[Components*v + c]);
+
+		writer.write(attributes);
 	}
+}
+
+void
+Mesh::writeObj(std::ostream& out) const {
 
-	// use the reduced vector of vertices (and normals)
+	BufferedWriter writer(out);
 
-	_vertices = usedVertices;
-	_normals  = usedNormals;
+	for (unsigned int i = 0; i < Components*getNumVertices(); i += Components)
+		writer.printf("v %g %g %g\n", _positions[i], _positions[i + 1], _positions[i + 2]);
 
-	// update the indices in the triangles
+	for (unsigned int i = 0; i < Components*getNumVertices(); i += Components)
+		writer.printf("vn %g %g %g\n", _normals[i], _normals[i + 1], _normals[i + 2]);
 
-	foreach (Triangle& triangle, _triangles) {
+	// OBJ indices start at 1
+	for (unsigned int i = 0; i < getNumTriangles(); i++) {
 
-		triangle.v0 = vertexTag[triangle.v0];
-		triangle.v1 = vertexTag[triangle.v1];
-		triangle.v2 = vertexTag[triangle.v2];
+		Triangle t = getTriangle(i);
+		writer.printf(
+				"f %u//%u %u//%u %u//%u\n",
+				t.v0 + 1, t.v0 + 1,
+				t.v1 + 1, t.v1 + 1,
+				t.v2 + 1, t.v2 + 1);
 	}
 }
 
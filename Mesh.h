@@ -1,10 +1,14 @@
 #ifndef SG_GUI_MESH_H__
 #define SG_GUI_MESH_H__
 
+#include <memory>
 #include <vector>
 #include <limits>
+#include <ostream>
 #include <imageprocessing/Volume.h>
 #include <util/foreach.h>
+#include <util/ray.hpp>
+#include "Bvh.h"
 #include "Point3d.h"
 #include "Vector3d.h"
 #include "Triangle.h"
@@ -13,42 +17,82 @@ namespace sg_gui {
 
 /**
  * A 3D mesh as a list of triangles.
+ *
+ * Positions, normals, and triangle vertex indices are stored in three 
+ * contiguous arrays of tightly packed values (structure of arrays):
+ *
+ *   positions: x0 y0 z0 x1 y1 z1 ...       (getPositionData(), PositionStride)
+ *   normals:   nx0 ny0 nz0 nx1 ny1 nz1 ... (getNormalData(),   NormalStride)
+ *   indices:   v0 v1 v2 of triangle 0, ... (getIndexData(),    TriangleStride)
+ *
+ * These arrays can be handed to OpenGl buffers, writers, or SIMD code without 
+ * copying. Pointers into them stay valid until the number of vertices or 
+ * triangles changes. Meshes can be moved, but not copied.
  */
 class Mesh : public Volume {
 
 public:
 
+	// the number of floats per position and normal
+	static const unsigned int Components = 3;
+
+	// the distance in bytes between consecutive positions, normals, and 
+	// triangles in their arrays
+	static const std::size_t PositionStride = Components*sizeof(float);
+	static const std::size_t NormalStride   = Components*sizeof(float);
+	static const std::size_t TriangleStride = 3*sizeof(unsigned int);
+
 	Mesh() {}
 
+	Mesh(Mesh&& other) = default;
+	Mesh& operator=(Mesh&& other) = default;
+
+	Mesh(const Mesh& other) = delete;
+	Mesh& operator=(const Mesh& other) = delete;
+
 	/**
 	 * Set the number of vertices (and normals) to allocate for this mesh.
 	 */
-	void setNumVertices(unsigned int numVertices)   { _vertices.resize(numVertices); _normals.resize(numVertices); }
+	void setNumVertices(unsigned int numVertices)   { _positions.resize(Components*numVertices); _normals.resize(Components*numVertices); setBoundingBoxDirty(); _bvh.reset(); }
 
 	/**
 	 * Set the number of triangles to allocate for this mesh.
 	 */
-	void setNumTriangles(unsigned int numTriangles) { _triangles.resize(numTriangles); }
+	void setNumTriangles(unsigned int numTriangles) { _indices.resize(3*numTriangles); _bvh.reset(); }
 
 	/**
 	 * Number of vertices (and normals) of this mesh.
 	 */
-	unsigned int getNumVertices()   { return _vertices.size(); }
+	unsigned int getNumVertices() const  { return _positions.size()/Components; }
 
 	/**
 	 * The number of triangles that constitute this mesh.
 	 */
-	unsigned int getNumTriangles() { return _triangles.size(); }
+	unsigned int getNumTriangles() const { return _indices.size()/3; }
 
 	/**
-	 * Set a vertex by index.
+	 * Set a vertex by index. The bounding box is computed once all vertices 
+	 * are set, i.e., after setNumVertices(). Call setBoundingBoxDirty() when 
+	 * changing vertices of a mesh whose bounding box was queried already.
 	 */
-	void setVertex(unsigned int index, const Point3d&  vertex) { _vertices[index] = vertex; setBoundingBoxDirty(); }
+	void setVertex(unsigned int index, const Point3d& vertex) {
+
+		float* p = &_positions[Components*index];
+		p[0] = vertex.x();
+		p[1] = vertex.y();
+		p[2] = vertex.z();
+	}
 
 	/**
 	 * Set a vertex' normal by index.
 	 */
-	void setNormal(unsigned int index, const Vector3d& normal) { _normals[index]  = normal; }
+	void setNormal(unsigned int index, const Vector3d& normal) {
+
+		float* n = &_normals[Components*index];
+		n[0] = normal.x();
+		n[1] = normal.y();
+		n[2] = normal.z();
+	}
 
 	/**
 	 * Set a triangle by specifying three vertices by index.
@@ -59,41 +103,94 @@ public:
 			unsigned int v2,
 			unsigned int v3) {
 
-		_triangles[index] = Triangle(v1, v2, v3);
+		unsigned int* t = &_indices[3*index];
+		t[0] = v1;
+		t[1] = v2;
+		t[2] = v3;
 	}
 
 	/**
 	 * Get a vertex by index.
 	 */
-	Point3d&  getVertex(unsigned int index) { return _vertices[index]; }
-	const Point3d&  getVertex(unsigned int index) const { return _vertices[index]; }
+	Point3d getVertex(unsigned int index) const {
+
+		const float* p = &_positions[Components*index];
+		return Point3d(p[0], p[1], p[2]);
+	}
 
 	/**
 	 * Get a vertex' normal by index.
 	 */
-	Vector3d& getNormal(unsigned int index) { return _normals[index];  }
-	const Vector3d& getNormal(unsigned int index) const { return _normals[index];  }
+	Vector3d getNormal(unsigned int index) const {
+
+		const float* n = &_normals[Components*index];
+		return Vector3d(n[0], n[1], n[2]);
+	}
 
 	/**
 	 * Get a triangle of this mesh by index.
 	 */
-	Triangle& getTriangle(unsigned int index) { return _triangles[index]; }
-	const Triangle& getTriangle(unsigned int index) const { return _triangles[index]; }
+	Triangle getTriangle(unsigned int index) const {
+
+		const unsigned int* t = &_indices[3*index];
+		return Triangle(t[0], t[1], t[2]);
+	}
+
+	/**
+	 * Direct access to the packed positions, getNumVertices()*Components 
+	 * floats. Call setBoundingBoxDirty() after modifying them.
+	 */
+	float*       getPositionData()       { return _positions.data(); }
+	const float* getPositionData() const { return _positions.data(); }
 
 	/**
-	 * Get a vector of all vertices of this mesh.
+	 * Direct access to the packed normals, getNumVertices()*Components floats.
 	 */
-	const std::vector<Point3d>&  getVertices()  const { return _vertices; }
+	float*       getNormalData()       { return _normals.data(); }
+	const float* getNormalData() const { return _normals.data(); }
 
 	/**
-	 * Get a vector of all normals of this mesh.
+	 * Direct access to the packed triangle vertex indices, 
+	 * getNumTriangles()*3 unsigned ints.
 	 */
-	const std::vector<Vector3d>& getNormals()   const { return _normals; }
+	unsigned int*       getIndexData()       { return _indices.data(); }
+	const unsigned int* getIndexData() const { return _indices.data(); }
 
 	/**
-	 * Get a vector of all triangles that constitute this mesh.
+	 * Reorder the triangles of this mesh for the post-transform vertex cache 
+	 * of the GPU (Forsyth, "Linear-Speed Vertex Cache Optimisation", 2006), 
+	 * and renumber the vertices in the order of their first use, such that 
+	 * drawing needs fewer vertex shader invocations and vertices are read 
+	 * sequentially. Vertices not used by any triangle are moved to the end.
+	 *
+	 * The shape of the mesh and its bounding box don't change, a bounding 
+	 * volume hierarchy has to be built again.
+	 *
+	 * @param cacheSize
+	 *              The number of vertices of the simulated LRU cache.
+	 */
+	void optimizeVertexCache(unsigned int cacheSize = 32);
+
+	/**
+	 * Build a bounding volume hierarchy over the triangles of this mesh, to 
+	 * speed up intersect(). Has to be called again after changing vertices or 
+	 * triangles.
+	 */
+	void buildBvh();
+
+	/**
+	 * Find the closest triangle hit by a ray. Uses the bounding volume 
+	 * hierarchy, if it was built, and tests all triangles otherwise.
+	 *
+	 * @param t
+	 *              Set to the ray parameter of the hit.
+	 *
+	 * @param triangle
+	 *              Set to the index of the triangle hit.
+	 *
+	 * @return true, if the ray hits this mesh.
 	 */
-	const std::vector<Triangle>& getTriangles() const { return _triangles; }
+	bool intersect(const util::ray<float,3>& ray, float& t, unsigned int& triangle) const;
 
 	/**
 	 * Create a submesh from a selection of triangles of this mesh.
@@ -101,35 +198,84 @@ public:
 	 * @param triangles
 	 *              Indices of the triangles to use in the submesh.
 	 *
-	 * @return A mesh containing only the specified triangles.
+	 * @return A mesh containing only the specified triangles and the vertices 
+	 *         they use.
 	 */
-	Mesh createSubmesh(const std::vector<unsigned int>& triangles);
+	Mesh createSubmesh(const std::vector<unsigned int>& triangles) const;
 
-private:
+	/**
+	 * Create several submeshes at once, in parallel.
+	 *
+	 * @param triangles
+	 *              For each submesh, the indices of the triangles to use.
+	 *
+	 * @param numThreads
+	 *              The number of threads to use, 0 for one per hardware 
+	 *              thread.
+	 *
+	 * @return One mesh per selection of triangles, in the same order.
+	 */
+	std::vector<Mesh> createSubmeshes(
+			const std::vector<std::vector<unsigned int>>& triangles,
+			unsigned int numThreads = 0) const;
+
+	/**
+	 * Write this mesh in binary PLY format, with one shared vertex (position 
+	 * and normal) per mesh vertex and indexed triangle faces.
+	 */
+	void writePly(std::ostream& out) const;
+
+	/**
+	 * Write this mesh in binary STL format. STL does not share vertices, each 
+	 * triangle is written with a face normal and its three vertex positions.
+	 */
+	void writeStl(std::ostream& out) const;
 
-	util::box<float,3> computeBoundingBox() const {
+	/**
+	 * Write this mesh in Wavefront OBJ format, with vertices, normals, and 
+	 * indexed faces.
+	 */
+	void writeObj(std::ostream& out) const;
 
-		util::box<float,3> bb;
+private:
 
-		for (const Point3d& p: _vertices)
-			bb.fit(p);
+	util::box<float,3> computeBoundingBox() const;
 
-		return bb;
-	}
+	/**
+	 * Ray-triangle intersection (Moeller-Trumbore), without culling of back 
+	 * faces.
+	 */
+	bool intersectTriangle(const util::ray<float,3>& ray, unsigned int triangle, float& t) const;
+
+	/**
+	 * Get the order in which to draw the triangles for optimizeVertexCache().
+	 */
+	std::vector<unsigned int> getVertexCacheOrder(unsigned int cacheSize) const;
 
 	/**
-	 * Remove all vertices (and normals) that are not used by any triangle.
+	 * Fill submesh with the given triangles and the vertices they use. remap 
+	 * has to have one entry per vertex of this mesh, all set to 
+	 * NoVertex, and is left that way.
 	 */
-	void strip();
+	void extractSubmesh(
+			const std::vector<unsigned int>& triangles,
+			std::vector<unsigned int>&       remap,
+			Mesh&                            submesh) const;
+
+	// marks vertices that are not used by a submesh in extractSubmesh()
+	static const unsigned int NoVertex = std::numeric_limits<unsigned int>::max();
+
+	// the packed vertex positions of the mesh
+	std::vector<float> _positions;
 
-	// the vertices of the mesh
-	std::vector<Point3d>  _vertices;
+	// the packed normals, one for each vertex
+	std::vector<float> _normals;
 
-	// the normals, one for each vertex
-	std::vector<Vector3d> _normals;
+	// three vertex indices for each triangle that makes up the mesh
+	std::vector<unsigned int> _indices;
 
-	// list of triangles that make up the mesh
-	std::vector<Triangle> _triangles;
+	// hierarchy over the triangles, if built
+	std::shared_ptr<Bvh> _bvh;
 };
 
 } // namespace sg_gui
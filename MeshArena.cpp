@@ -0,0 +1,560 @@
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <util/Logger.h>
+#include "MeshArena.h"
+
+logger::LogChannel mesharenalog("mesharenalog", "[MeshArena] ");
+
+namespace sg_gui {
+
+const std::size_t MeshArena::InitialVertices;
+const std::size_t MeshArena::InitialIndices;
+const std::size_t MeshArena::InitialSlots;
+const unsigned int MeshArena::MaxCompactVertices;
+
+void
+MeshArena::RangeAllocator::reset(std::size_t capacity) {
+
+	_free.clear();
+	if (capacity > 0)
+		_free[0] = capacity;
+
+	_capacity = capacity;
+	_used     = 0;
+}
+
+bool
+MeshArena::RangeAllocator::allocate(std::size_t size, std::size_t& offset) {
+
+	if (size == 0) {
+
+		offset = 0;
+		return true;
+	}
+
+	for (auto i = _free.begin(); i != _free.end(); i++) {
+
+		if (i->second < size)
+			continue;
+
+		offset = i->first;
+
+		std::size_t remaining = i->second - size;
+		_free.erase(i);
+		if (remaining > 0)
+			_free[offset + size] = remaining;
+
+		_used += size;
+
+		return true;
+	}
+
+	return false;
+}
+
+void
+MeshArena::RangeAllocator::release(std::size_t offset, std::size_t size) {
+
+	if (size == 0)
+		return;
+
+	_used -= size;
+
+	auto next = _free.lower_bound(offset);
+
+	// merge with the following range
+	if (next != _free.end() && next->first == offset + size) {
+
+		size += next->second;
+		next = _free.erase(next);
+	}
+
+	// merge with the preceding range
+	if (next != _free.begin()) {
+
+		auto previous = std::prev(next);
+
+		if (previous->first + previous->second == offset) {
+
+			previous->second += size;
+			return;
+		}
+	}
+
+	_free[offset] = size;
+}
+
+bool
+MeshArena::isSupported() {
+
+	return
+			GLEW_VERSION_4_3 ||
+			(GLEW_VERSION_3_3 && GLEW_ARB_draw_indirect && GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance);
+}
+
+MeshArena::MeshArena(bool compact) :
+	_compact(compact),
+	_positionBuffer(0),
+	_normalBuffer(0),
+	_indexBuffer(0),
+	_meshBuffer(0),
+	_commandBuffer(0),
+	_slotCapacity(0),
+	_numSlots(0) {}
+
+MeshArena::~MeshArena() {
+
+	// make sure we have a valid OpenGl context
+	OpenGl::Guard guard;
+
+	deleteBuffers();
+}
+
+void
+MeshArena::upload(std::shared_ptr<Mesh> mesh) {
+
+	free(mesh);
+
+	Allocation allocation;
+	allocate(*mesh, allocation);
+	allocation.slot = allocateSlot();
+
+	LOG_ALL(mesharenalog)
+			<< "uploading mesh with " << allocation.numVertices << " vertices to "
+			<< allocation.vertexOffset << " and " << allocation.numIndices
+			<< " indices to " << allocation.indexOffset << std::endl;
+
+	// white until a color is set
+	MeshData data;
+	std::fill(data.color, data.color + 4, 255);
+	std::fill(data.positionOffset, data.positionOffset + 3, 0.0f);
+	std::fill(data.positionScale, data.positionScale + 3, 1.0f);
+
+	if (_compact) {
+
+		std::vector<CompactVertex> vertices;
+		encodeCompact(*mesh, vertices, data.positionOffset, data.positionScale);
+
+		std::vector<uint16_t> indices(mesh->getIndexData(), mesh->getIndexData() + allocation.numIndices);
+
+		glCheck(glBindBuffer(GL_ARRAY_BUFFER, _positionBuffer));
+		glCheck(glBufferSubData(GL_ARRAY_BUFFER, allocation.vertexOffset*sizeof(CompactVertex), vertices.size()*sizeof(CompactVertex), vertices.data()));
+		glCheck(glBindBuffer(GL_ARRAY_BUFFER, 0));
+
+		glCheck(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBuffer));
+		glCheck(glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, allocation.indexOffset*sizeof(uint16_t), indices.size()*sizeof(uint16_t), indices.data()));
+		glCheck(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+
+	} else {
+
+		glCheck(glBindBuffer(GL_ARRAY_BUFFER, _positionBuffer));
+		glCheck(glBufferSubData(GL_ARRAY_BUFFER, allocation.vertexOffset*Mesh::PositionStride, allocation.numVertices*Mesh::PositionStride, mesh->getPositionData()));
+		glCheck(glBindBuffer(GL_ARRAY_BUFFER, _normalBuffer));
+		glCheck(glBufferSubData(GL_ARRAY_BUFFER, allocation.vertexOffset*Mesh::NormalStride, allocation.numVertices*Mesh::NormalStride, mesh->getNormalData()));
+		glCheck(glBindBuffer(GL_ARRAY_BUFFER, 0));
+
+		glCheck(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBuffer));
+		glCheck(glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, allocation.indexOffset*sizeof(unsigned int), allocation.numIndices*sizeof(unsigned int), mesh->getIndexData()));
+		glCheck(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+	}
+
+	writeMeshData(allocation, data);
+
+	_allocations[mesh] = allocation;
+}
+
+void
+MeshArena::free(std::shared_ptr<Mesh> mesh) {
+
+	auto i = _allocations.find(mesh);
+
+	if (i == _allocations.end())
+		return;
+
+	release(i->second);
+	_allocations.erase(i);
+
+	// give memory back if the buffers are mostly empty
+	if (_vertices.getCapacity() > InitialVertices && _vertices.getUsed() < _vertices.getCapacity()/4)
+		relayout(
+				std::max(InitialVertices, 2*_vertices.getUsed()),
+				std::max(InitialIndices, 2*_indices.getUsed()));
+}
+
+void
+MeshArena::clear() {
+
+	_allocations.clear();
+	deleteBuffers();
+
+	_vertices.reset(0);
+	_indices.reset(0);
+
+	_slotCapacity = 0;
+	_numSlots     = 0;
+	_freeSlots.clear();
+}
+
+std::vector<std::shared_ptr<Mesh>>
+MeshArena::getMeshes() const {
+
+	std::vector<std::shared_ptr<Mesh>> meshes;
+	meshes.reserve(_allocations.size());
+
+	for (auto& p : _allocations)
+		meshes.push_back(p.first);
+
+	return meshes;
+}
+
+void
+MeshArena::setColor(std::shared_ptr<Mesh> mesh, const MeshColor& color) {
+
+	auto i = _allocations.find(mesh);
+
+	if (i == _allocations.end())
+		return;
+
+	Allocation& allocation = i->second;
+
+	if (allocation.hasColor &&
+	    allocation.color.r == color.r &&
+	    allocation.color.g == color.g &&
+	    allocation.color.b == color.b)
+		return;
+
+	allocation.hasColor = true;
+	allocation.color    = color;
+
+	writeColor(allocation);
+}
+
+void
+MeshArena::draw(const std::vector<std::shared_ptr<Mesh>>& meshes, ShaderProgram* program) {
+
+	_commands.clear();
+
+	for (const std::shared_ptr<Mesh>& mesh : meshes) {
+
+		auto i = _allocations.find(mesh);
+
+		if (i == _allocations.end() || i->second.numIndices == 0)
+			continue;
+
+		const Allocation& allocation = i->second;
+
+		DrawCommand command;
+		command.count         = allocation.numIndices;
+		command.instanceCount = 1;
+		command.firstIndex    = allocation.indexOffset;
+		command.baseVertex    = allocation.vertexOffset;
+		command.baseInstance  = allocation.slot;
+
+		_commands.push_back(command);
+	}
+
+	if (_commands.empty())
+		return;
+
+	if (_compact && !program)
+		UTIL_THROW_EXCEPTION(
+				OpenGlError,
+				"compact meshes can only be drawn with a decoding shader program");
+
+	// per mesh attributes, read with a divisor of one
+	GLint meshColor      = -1;
+	GLint positionOffset = -1;
+	GLint positionScale  = -1;
+
+	// per vertex attributes
+	GLint octNormal      = -1;
+
+	if (program) {
+
+		meshColor = program->getAttributeLocation("meshColor");
+
+		if (_compact) {
+
+			positionOffset = program->getAttributeLocation("positionOffset");
+			positionScale  = program->getAttributeLocation("positionScale");
+			octNormal      = program->getAttributeLocation("octNormal");
+		}
+	}
+
+	if (!_commandBuffer)
+		glCheck(glGenBuffers(1, &_commandBuffer));
+
+	// orphan the commands of the previous frame
+	glCheck(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _commandBuffer));
+	glCheck(glBufferData(GL_DRAW_INDIRECT_BUFFER, _commands.size()*sizeof(DrawCommand), _commands.data(), GL_STREAM_DRAW));
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glCheck(glBindBuffer(GL_ARRAY_BUFFER, _positionBuffer));
+
+	if (_compact) {
+
+		glVertexPointer(3, GL_SHORT, sizeof(CompactVertex), 0);
+
+		if (octNormal >= 0) {
+
+			glEnableVertexAttribArray(octNormal);
+			glVertexAttribPointer(octNormal, 2, GL_SHORT, GL_TRUE, sizeof(CompactVertex), reinterpret_cast<const GLvoid*>(offsetof(CompactVertex, normal)));
+		}
+
+	} else {
+
+		glEnableClientState(GL_NORMAL_ARRAY);
+		glVertexPointer(Mesh::Components, GL_FLOAT, Mesh::PositionStride, 0);
+		glCheck(glBindBuffer(GL_ARRAY_BUFFER, _normalBuffer));
+		glNormalPointer(GL_FLOAT, Mesh::NormalStride, 0);
+	}
+
+	// one value per instance, i.e., per mesh
+	glCheck(glBindBuffer(GL_ARRAY_BUFFER, _meshBuffer));
+
+	auto perMesh = [](GLint attribute, GLint size, GLenum type, GLboolean normalized, std::size_t offset) {
+
+		if (attribute < 0)
+			return;
+
+		glEnableVertexAttribArray(attribute);
+		glVertexAttribPointer(attribute, size, type, normalized, sizeof(MeshData), reinterpret_cast<const GLvoid*>(offset));
+		glVertexAttribDivisor(attribute, 1);
+	};
+
+	perMesh(meshColor,      4, GL_UNSIGNED_BYTE, GL_TRUE,  offsetof(MeshData, color));
+	perMesh(positionOffset, 3, GL_FLOAT,         GL_FALSE, offsetof(MeshData, positionOffset));
+	perMesh(positionScale,  3, GL_FLOAT,         GL_FALSE, offsetof(MeshData, positionScale));
+
+	glCheck(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBuffer));
+	glCheck(glMultiDrawElementsIndirect(
+			GL_TRIANGLES,
+			_compact ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT,
+			0,
+			_commands.size(),
+			0));
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+	for (GLint attribute : { meshColor, positionOffset, positionScale })
+		if (attribute >= 0) {
+
+			glVertexAttribDivisor(attribute, 0);
+			glDisableVertexAttribArray(attribute);
+		}
+
+	if (octNormal >= 0)
+		glDisableVertexAttribArray(octNormal);
+
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+void
+MeshArena::allocate(const Mesh& mesh, Allocation& allocation) {
+
+	allocation.numVertices = mesh.getNumVertices();
+	allocation.numIndices  = 3*mesh.getNumTriangles();
+
+	if (_vertices.allocate(allocation.numVertices, allocation.vertexOffset)) {
+
+		if (_indices.allocate(allocation.numIndices, allocation.indexOffset))
+			return;
+
+		_vertices.release(allocation.vertexOffset, allocation.numVertices);
+	}
+
+	// compact the buffers, and grow them if they would be more than three 
+	// quarters full afterwards
+	std::size_t vertexCapacity = _vertices.getCapacity();
+	std::size_t indexCapacity  = _indices.getCapacity();
+	std::size_t numVertices    = _vertices.getUsed() + allocation.numVertices;
+	std::size_t numIndices     = _indices.getUsed() + allocation.numIndices;
+
+	if (4*numVertices > 3*vertexCapacity)
+		vertexCapacity = std::max(InitialVertices, 2*numVertices);
+	if (4*numIndices > 3*indexCapacity)
+		indexCapacity = std::max(InitialIndices, 2*numIndices);
+
+	relayout(vertexCapacity, indexCapacity);
+
+	// all free space is at the end now
+	_vertices.allocate(allocation.numVertices, allocation.vertexOffset);
+	_indices.allocate(allocation.numIndices, allocation.indexOffset);
+}
+
+void
+MeshArena::release(const Allocation& allocation) {
+
+	_vertices.release(allocation.vertexOffset, allocation.numVertices);
+	_indices.release(allocation.indexOffset, allocation.numIndices);
+	_freeSlots.push_back(allocation.slot);
+}
+
+std::size_t
+MeshArena::allocateSlot() {
+
+	if (!_freeSlots.empty()) {
+
+		std::size_t slot = _freeSlots.back();
+		_freeSlots.pop_back();
+
+		return slot;
+	}
+
+	if (_numSlots == _slotCapacity) {
+
+		std::size_t capacity = std::max(InitialSlots, 2*_slotCapacity);
+
+		LOG_DEBUG(mesharenalog) << "growing the per-mesh buffer to " << capacity << " slots" << std::endl;
+
+		GLuint buffer;
+		glCheck(glGenBuffers(1, &buffer));
+		glCheck(glBindBuffer(GL_COPY_WRITE_BUFFER, buffer));
+		glCheck(glBufferData(GL_COPY_WRITE_BUFFER, capacity*sizeof(MeshData), 0, GL_DYNAMIC_DRAW));
+
+		if (_meshBuffer) {
+
+			glCheck(glBindBuffer(GL_COPY_READ_BUFFER, _meshBuffer));
+			glCheck(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, _numSlots*sizeof(MeshData)));
+			glCheck(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+			glCheck(glDeleteBuffers(1, &_meshBuffer));
+		}
+
+		glCheck(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+
+		_meshBuffer   = buffer;
+		_slotCapacity = capacity;
+	}
+
+	return _numSlots++;
+}
+
+void
+MeshArena::relayout(std::size_t vertexCapacity, std::size_t indexCapacity) {
+
+	LOG_DEBUG(mesharenalog)
+			<< "moving " << _allocations.size() << " meshes with "
+			<< _vertices.getUsed() << " vertices and " << _indices.getUsed()
+			<< " indices into buffers for " << vertexCapacity << " vertices and "
+			<< indexCapacity << " indices" << std::endl;
+
+	// compact arenas have no normal buffer
+	GLuint buffers[3] = { 0, 0, 0 };
+	glCheck(glGenBuffers(1, &buffers[0]));
+	if (!_compact)
+		glCheck(glGenBuffers(1, &buffers[1]));
+	glCheck(glGenBuffers(1, &buffers[2]));
+
+	auto createBuffer = [](GLuint buffer, std::size_t size) {
+
+		glCheck(glBindBuffer(GL_COPY_WRITE_BUFFER, buffer));
+		glCheck(glBufferData(GL_COPY_WRITE_BUFFER, size, 0, GL_STATIC_DRAW));
+	};
+
+	createBuffer(buffers[0], vertexCapacity*vertexStride());
+	if (!_compact)
+		createBuffer(buffers[1], vertexCapacity*Mesh::NormalStride);
+	createBuffer(buffers[2], indexCapacity*indexStride());
+
+	// pack all meshes at the front of the new buffers
+	RangeAllocator vertices;
+	RangeAllocator indices;
+	vertices.reset(vertexCapacity);
+	indices.reset(indexCapacity);
+
+	std::vector<Allocation*> moved;
+	std::vector<Allocation>  previous;
+	moved.reserve(_allocations.size());
+	previous.reserve(_allocations.size());
+
+	for (auto& p : _allocations) {
+
+		Allocation& allocation = p.second;
+		previous.push_back(allocation);
+		moved.push_back(&allocation);
+
+		vertices.allocate(allocation.numVertices, allocation.vertexOffset);
+		indices.allocate(allocation.numIndices, allocation.indexOffset);
+	}
+
+	auto copy = [&](GLuint from, GLuint to, std::size_t stride, bool index) {
+
+		if (from == 0)
+			return;
+
+		glCheck(glBindBuffer(GL_COPY_READ_BUFFER, from));
+		glCheck(glBindBuffer(GL_COPY_WRITE_BUFFER, to));
+
+		for (std::size_t i = 0; i < moved.size(); i++) {
+
+			std::size_t size = (index ? moved[i]->numIndices : moved[i]->numVertices)*stride;
+
+			if (size == 0)
+				continue;
+
+			glCheck(glCopyBufferSubData(
+					GL_COPY_READ_BUFFER,
+					GL_COPY_WRITE_BUFFER,
+					(index ? previous[i].indexOffset : previous[i].vertexOffset)*stride,
+					(index ? moved[i]->indexOffset : moved[i]->vertexOffset)*stride,
+					size));
+		}
+	};
+
+	copy(_positionBuffer, buffers[0], vertexStride(),     false);
+	copy(_normalBuffer,   buffers[1], Mesh::NormalStride, false);
+	copy(_indexBuffer,    buffers[2], indexStride(),      true);
+
+	glCheck(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+	glCheck(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+
+	for (GLuint* buffer : { &_positionBuffer, &_normalBuffer, &_indexBuffer })
+		if (*buffer)
+			glCheck(glDeleteBuffers(1, buffer));
+
+	_positionBuffer = buffers[0];
+	_normalBuffer   = buffers[1];
+	_indexBuffer    = buffers[2];
+
+	_vertices = vertices;
+	_indices  = indices;
+}
+
+void
+MeshArena::writeColor(const Allocation& allocation) {
+
+	unsigned char color[4] = {
+			allocation.color.r,
+			allocation.color.g,
+			allocation.color.b,
+			255 };
+
+	glCheck(glBindBuffer(GL_ARRAY_BUFFER, _meshBuffer));
+	glCheck(glBufferSubData(GL_ARRAY_BUFFER, allocation.slot*sizeof(MeshData) + offsetof(MeshData, color), sizeof(color), color));
+	glCheck(glBindBuffer(GL_ARRAY_BUFFER, 0));
+}
+
+void
+MeshArena::writeMeshData(const Allocation& allocation, const MeshData& data) {
+
+	glCheck(glBindBuffer(GL_ARRAY_BUFFER, _meshBuffer));
+	glCheck(glBufferSubData(GL_ARRAY_BUFFER, allocation.slot*sizeof(MeshData), sizeof(MeshData), &data));
+	glCheck(glBindBuffer(GL_ARRAY_BUFFER, 0));
+}
+
+void
+MeshArena::deleteBuffers() {
+
+	for (GLuint* buffer : { &_positionBuffer, &_normalBuffer, &_indexBuffer, &_meshBuffer, &_commandBuffer })
+		if (*buffer) {
+
+			glCheck(glDeleteBuffers(1, buffer));
+			*buffer = 0;
+		}
+}
+
+} // namespace sg_gui
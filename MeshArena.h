@@ -0,0 +1,275 @@
+#ifndef SG_GUI_MESH_ARENA_H__
+#define SG_GUI_MESH_ARENA_H__
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <vector>
+#include "OpenGl.h"
+#include "CompactVertex.h"
+#include "Mesh.h"
+#include "ShaderProgram.h"
+
+namespace sg_gui {
+
+/**
+ * An RGB color for a mesh in an arena.
+ */
+struct MeshColor {
+
+	unsigned char r;
+	unsigned char g;
+	unsigned char b;
+};
+
+/**
+ * Keeps the geometry of many meshes in a single set of buffer objects on the
+ * GPU, such that any number of them can be drawn with one call to
+ * glMultiDrawElementsIndirect.
+ *
+ * Vertices and indices of each mesh are sub-allocated from the shared buffers
+ * with a first-fit free-list. Indices stay relative to the first vertex of
+ * their mesh. If an allocation does not fit, all meshes are moved to the front
+ * of (possibly larger) new buffers on the GPU, which also happens when the
+ * buffers are mostly empty after freeing meshes.
+ *
+ * Each mesh has a slot in a small per-mesh buffer that holds its color. The
+ * slot is the base instance of the mesh's draw command, such that a vertex
+ * attribute with a divisor of one reads the color of its mesh, and meshes of
+ * different colors can be drawn in one call.
+ *
+ * A compact arena keeps vertices in the compact encoding (see CompactVertex)
+ * and indices in 16 bit, which is half the memory. It only accepts meshes
+ * with at most 2^16 vertices, and the slot of each mesh holds its decoding
+ * parameters next to its color.
+ *
+ * All methods have to be called with an active OpenGl context.
+ */
+class MeshArena {
+
+public:
+
+	/**
+	 * Check whether the current OpenGl context supports indirect multi-draws
+	 * with base vertices and instances, instanced attributes, and copying
+	 * between buffers.
+	 */
+	static bool isSupported();
+
+	/**
+	 * Create an arena. If compact is true, meshes are kept in the compact 
+	 * encoding.
+	 */
+	MeshArena(bool compact = false);
+
+	/**
+	 * Frees all buffers.
+	 */
+	~MeshArena();
+
+	bool isCompact() const { return _compact; }
+
+	/**
+	 * Check whether the given mesh can be uploaded to this arena.
+	 */
+	bool accepts(const Mesh& mesh) const { return !_compact || mesh.getNumVertices() <= MaxCompactVertices; }
+
+	/**
+	 * Copy the vertices, normals, and triangles of the given mesh into the
+	 * arena. If the mesh was uploaded before, it is replaced.
+	 */
+	void upload(std::shared_ptr<Mesh> mesh);
+
+	/**
+	 * Release the space of the given mesh.
+	 */
+	void free(std::shared_ptr<Mesh> mesh);
+
+	/**
+	 * Release all meshes and free the buffers.
+	 */
+	void clear();
+
+	/**
+	 * Check whether the given mesh is in the arena.
+	 */
+	bool contains(std::shared_ptr<Mesh> mesh) const { return _allocations.count(mesh); }
+
+	/**
+	 * Get all meshes in the arena.
+	 */
+	std::vector<std::shared_ptr<Mesh>> getMeshes() const;
+
+	/**
+	 * Set the color of a mesh in the arena. Touches the buffers only if the
+	 * color changed.
+	 */
+	void setColor(std::shared_ptr<Mesh> mesh, const MeshColor& color);
+
+	/**
+	 * Draw the given meshes of the arena with a single call. If given, the 
+	 * bound program receives the attributes
+	 *
+	 *   attribute vec4 meshColor;       // the color set with setColor()
+	 *   attribute vec3 positionOffset;  // the decoding parameters of compact
+	 *   attribute vec3 positionScale;   //   meshes, see CompactVertex
+	 *   attribute vec2 octNormal;       // octahedral normal in [-1,1]^2
+	 *
+	 * of which only the first one is set for arenas that are not compact. A 
+	 * program is required for compact arenas.
+	 */
+	void draw(const std::vector<std::shared_ptr<Mesh>>& meshes, ShaderProgram* program = 0);
+
+private:
+
+	/**
+	 * First-fit allocation of ranges in [0, capacity).
+	 */
+	class RangeAllocator {
+
+	public:
+
+		RangeAllocator() : _capacity(0), _used(0) {}
+
+		/**
+		 * Reset to a single free range of the given size.
+		 */
+		void reset(std::size_t capacity);
+
+		/**
+		 * Find a free range of the given size. Returns false if there is none.
+		 */
+		bool allocate(std::size_t size, std::size_t& offset);
+
+		/**
+		 * Return a range and merge it with its free neighbors.
+		 */
+		void release(std::size_t offset, std::size_t size);
+
+		std::size_t getCapacity() const { return _capacity; }
+
+		std::size_t getUsed() const { return _used; }
+
+	private:
+
+		// free ranges by offset
+		std::map<std::size_t, std::size_t> _free;
+
+		std::size_t _capacity;
+		std::size_t _used;
+	};
+
+	struct Allocation {
+
+		Allocation() :
+			vertexOffset(0),
+			numVertices(0),
+			indexOffset(0),
+			numIndices(0),
+			slot(0),
+			hasColor(false) {}
+
+		// in vertices
+		std::size_t vertexOffset;
+		std::size_t numVertices;
+
+		// in indices
+		std::size_t indexOffset;
+		std::size_t numIndices;
+
+		// in the per-mesh buffer
+		std::size_t slot;
+
+		bool      hasColor;
+		MeshColor color;
+	};
+
+	// the arguments of one draw in glMultiDrawElementsIndirect
+	struct DrawCommand {
+
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint  baseVertex;
+		GLuint baseInstance;
+	};
+
+	// the space for this many vertices and indices is reserved for the first
+	// mesh
+	static const std::size_t InitialVertices = 1 << 16;
+	static const std::size_t InitialIndices  = 1 << 18;
+
+	// the content of a slot in the per-mesh buffer
+	struct MeshData {
+
+		unsigned char color[4];
+		float         positionOffset[3];
+		float         positionScale[3];
+	};
+
+	// the number of slots reserved for the first mesh
+	static const std::size_t InitialSlots = 1 << 10;
+
+	// the most vertices a mesh in a compact arena can have
+	static const unsigned int MaxCompactVertices = 1 << 16;
+
+	// bytes per vertex and per index in the buffers
+	std::size_t vertexStride() const { return (_compact ? sizeof(CompactVertex) : Mesh::PositionStride); }
+	std::size_t indexStride() const { return (_compact ? sizeof(uint16_t) : sizeof(unsigned int)); }
+
+	/**
+	 * Reserve space for the given mesh, rearranging the buffers if needed.
+	 */
+	void allocate(const Mesh& mesh, Allocation& allocation);
+
+	void release(const Allocation& allocation);
+
+	/**
+	 * Get an unused slot in the per-mesh buffer, growing it if needed.
+	 */
+	std::size_t allocateSlot();
+
+	/**
+	 * Move all meshes to the front of new buffers of the given capacities.
+	 */
+	void relayout(std::size_t vertexCapacity, std::size_t indexCapacity);
+
+	void writeColor(const Allocation& allocation);
+
+	void writeMeshData(const Allocation& allocation, const MeshData& data);
+
+	void deleteBuffers();
+
+	bool _compact;
+
+	// float positions or CompactVertices
+	GLuint _positionBuffer;
+
+	// float normals, unused for compact arenas
+	GLuint _normalBuffer;
+
+	GLuint _indexBuffer;
+	GLuint _meshBuffer;
+	GLuint _commandBuffer;
+
+	RangeAllocator _vertices;
+	RangeAllocator _indices;
+
+	// the number of slots in the per-mesh buffer, of which all below 
+	// _numSlots were handed out once, and the ones released since
+	std::size_t              _slotCapacity;
+	std::size_t              _numSlots;
+	std::vector<std::size_t> _freeSlots;
+
+	// the meshes are kept alive while they are in the arena, such that the
+	// key can not be reused by another mesh
+	std::map<std::shared_ptr<Mesh>, Allocation> _allocations;
+
+	// the commands of the draw call, kept to avoid allocations per frame
+	std::vector<DrawCommand> _commands;
+};
+
+} // namespace sg_gui
+
+#endif // SG_GUI_MESH_ARENA_H__
+
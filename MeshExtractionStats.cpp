@@ -0,0 +1,284 @@
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <sstream>
+#include "MeshExtractionStats.h"
+
+namespace sg_gui {
+
+const std::size_t MeshExtractionStats::MaxFinished;
+
+namespace {
+
+/**
+ * Milliseconds between two timestamps.
+ */
+double
+milliseconds(MeshExtractionStats::Clock::time_point from, MeshExtractionStats::Clock::time_point to) {
+
+	return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+MeshExtractionStats::Percentiles
+percentiles(std::vector<double>& values) {
+
+	MeshExtractionStats::Percentiles result;
+
+	result.count = values.size();
+
+	if (values.empty())
+		return result;
+
+	auto nth = [&values](double q) {
+
+		std::size_t n = std::min(values.size() - 1, static_cast<std::size_t>(q*values.size()));
+		std::nth_element(values.begin(), values.begin() + n, values.end());
+		return values[n];
+	};
+
+	result.p50 = nth(0.5);
+	result.p95 = nth(0.95);
+
+	return result;
+}
+
+} // anonymous namespace
+
+void
+MeshExtractionStats::enqueued(uint64_t label, float downsample) {
+
+	if (!_enabled)
+		return;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	Job& j = _jobs[Key(label, downsample)];
+	j.label      = label;
+	j.downsample = downsample;
+	j.enqueued   = Clock::now();
+	_queueDepth++;
+}
+
+void
+MeshExtractionStats::started(uint64_t label, float downsample) {
+
+	if (!_enabled)
+		return;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if (Job* j = job(label, downsample))
+		j->started = Clock::now();
+	_queueDepth--;
+	_numRunning++;
+}
+
+void
+MeshExtractionStats::extracted(uint64_t label, float downsample, unsigned int numVertices, unsigned int numTriangles) {
+
+	if (!_enabled)
+		return;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if (Job* j = job(label, downsample)) {
+
+		j->extracted    = Clock::now();
+		j->numVertices  = numVertices;
+		j->numTriangles = numTriangles;
+	}
+	_numRunning--;
+}
+
+void
+MeshExtractionStats::stored(uint64_t label, float downsample) {
+
+	if (!_enabled)
+		return;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if (Job* j = job(label, downsample))
+		j->stored = Clock::now();
+}
+
+void
+MeshExtractionStats::uploaded(uint64_t label, float downsample) {
+
+	if (!_enabled)
+		return;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if (Job* j = job(label, downsample))
+		j->uploaded = Clock::now();
+}
+
+void
+MeshExtractionStats::drawn(const std::vector<std::pair<uint64_t, float>>& lods) {
+
+	if (!_enabled)
+		return;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	Clock::time_point now = Clock::now();
+
+	for (const Key& key : lods) {
+
+		// jobs drawn before are finished already
+		auto i = _jobs.find(key);
+		if (i == _jobs.end())
+			continue;
+
+		i->second.firstDrawn = now;
+
+		// coarser levels of the same label will not be drawn anymore
+		auto coarser = std::next(i);
+		while (coarser != _jobs.end() && coarser->first.first == key.first)
+			coarser = retire(coarser);
+
+		retire(i);
+	}
+}
+
+void
+MeshExtractionStats::hidden(uint64_t label) {
+
+	if (!_enabled)
+		return;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	auto i = _jobs.lower_bound(Key(label, std::numeric_limits<float>::lowest()));
+	while (i != _jobs.end() && i->first.first == label)
+		i = retire(i);
+}
+
+std::vector<MeshExtractionStats::Job>
+MeshExtractionStats::getJobs() {
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	std::vector<Job> jobs;
+	jobs.reserve(_jobs.size() + _finished.size());
+	for (auto& p : _jobs)
+		jobs.push_back(p.second);
+	jobs.insert(jobs.end(), _finished.begin(), _finished.end());
+
+	return jobs;
+}
+
+std::size_t
+MeshExtractionStats::getQueueDepth() {
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	return _queueDepth;
+}
+
+std::size_t
+MeshExtractionStats::getNumRunning() {
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	return _numRunning;
+}
+
+std::map<float, MeshExtractionStats::LodSummary>
+MeshExtractionStats::getSummary() {
+
+	const Clock::time_point none;
+
+	// durations per level of detail
+	struct Durations {
+		std::vector<double> queued, extraction, lockWait, upload, latency;
+	};
+	std::map<float, Durations>  durations;
+	std::map<float, LodSummary> summary;
+
+	for (const Job& j : getJobs()) {
+
+		LodSummary& s = summary[j.downsample];
+		Durations&  d = durations[j.downsample];
+
+		s.numJobs++;
+		s.numVertices  += j.numVertices;
+		s.numTriangles += j.numTriangles;
+
+		if (j.started != none)
+			d.queued.push_back(milliseconds(j.enqueued, j.started));
+		if (j.extracted != none)
+			d.extraction.push_back(milliseconds(j.started, j.extracted));
+		if (j.stored != none)
+			d.lockWait.push_back(milliseconds(j.extracted, j.stored));
+		if (j.uploaded != none)
+			d.upload.push_back(milliseconds(j.stored, j.uploaded));
+		if (j.firstDrawn != none)
+			d.latency.push_back(milliseconds(j.enqueued, j.firstDrawn));
+	}
+
+	for (auto& p : durations) {
+
+		LodSummary& s = summary[p.first];
+
+		s.queued     = percentiles(p.second.queued);
+		s.extraction = percentiles(p.second.extraction);
+		s.lockWait   = percentiles(p.second.lockWait);
+		s.upload     = percentiles(p.second.upload);
+		s.latency    = percentiles(p.second.latency);
+	}
+
+	return summary;
+}
+
+std::string
+MeshExtractionStats::getSummaryString() {
+
+	std::stringstream ss;
+
+	ss << "queued " << getQueueDepth() << ", running " << getNumRunning();
+
+	auto print = [&ss](const char* name, const Percentiles& p) {
+
+		ss << " " << name << " " << p.p50 << "/" << p.p95;
+	};
+
+	// from coarse to fine
+	std::map<float, LodSummary> summary = getSummary();
+	for (auto i = summary.rbegin(); i != summary.rend(); i++) {
+
+		const LodSummary& s = i->second;
+
+		ss << " | x" << i->first << ": " << s.numJobs << " jobs, " << s.numTriangles << " triangles, p50/p95 ms:";
+		print("queued",  s.queued);
+		print("extract", s.extraction);
+		print("lock",    s.lockWait);
+		print("upload",  s.upload);
+		print("latency", s.latency);
+	}
+
+	return ss.str();
+}
+
+MeshExtractionStats::Job*
+MeshExtractionStats::job(uint64_t label, float downsample) {
+
+	auto i = _jobs.find(Key(label, downsample));
+	if (i == _jobs.end())
+		return 0;
+
+	return &i->second;
+}
+
+std::map<MeshExtractionStats::Key, MeshExtractionStats::Job>::iterator
+MeshExtractionStats::retire(std::map<Key, Job>::iterator i) {
+
+	_finished.push_back(i->second);
+	if (_finished.size() > MaxFinished)
+		_finished.pop_front();
+
+	return _jobs.erase(i);
+}
+
+} // namespace sg_gui
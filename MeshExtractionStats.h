@@ -0,0 +1,194 @@
+#ifndef SG_GUI_MESH_EXTRACTION_STATS_H__
+#define SG_GUI_MESH_EXTRACTION_STATS_H__
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace sg_gui {
+
+/**
+ * Thread-safe record of the life cycle of mesh extraction jobs, one per label
+ * and level of detail: from being enqueued to the first time the mesh was
+ * drawn. Jobs that were drawn are finished, as well as jobs that will not be
+ * drawn anymore: coarser levels of a label after a finer one was drawn, and
+ * all levels of a hidden label. Only the most recent MaxFinished of them are
+ * kept.
+ */
+class MeshExtractionStats {
+
+public:
+
+	typedef std::chrono::steady_clock Clock;
+
+	// the number of finished jobs to keep for the summary
+	static const std::size_t MaxFinished = 4096;
+
+	/**
+	 * The timestamps and sizes of a single job. Timestamps of stages that were
+	 * not reached yet are equal to Clock::time_point().
+	 */
+	struct Job {
+
+		Job() : label(0), downsample(0), numVertices(0), numTriangles(0) {}
+
+		uint64_t label;
+		float    downsample;
+
+		// the job was scheduled
+		Clock::time_point enqueued;
+
+		// a thread started working on the job
+		Clock::time_point started;
+
+		// marching cubes finished
+		Clock::time_point extracted;
+
+		// the lock on the meshes was acquired to store the result
+		Clock::time_point stored;
+
+		// the mesh was uploaded to the GPU
+		Clock::time_point uploaded;
+
+		// the mesh was drawn for the first time
+		Clock::time_point firstDrawn;
+
+		unsigned int numVertices;
+		unsigned int numTriangles;
+	};
+
+	/**
+	 * Durations in milliseconds between two stages of jobs, at the 50th and
+	 * 95th percentile over all jobs that reached both stages.
+	 */
+	struct Percentiles {
+
+		Percentiles() : count(0), p50(0), p95(0) {}
+
+		std::size_t count;
+		double p50;
+		double p95;
+	};
+
+	/**
+	 * Summary of all jobs of one level of detail.
+	 */
+	struct LodSummary {
+
+		LodSummary() : numJobs(0), numVertices(0), numTriangles(0) {}
+
+		std::size_t numJobs;
+
+		// enqueued -> started
+		Percentiles queued;
+
+		// started -> extracted
+		Percentiles extraction;
+
+		// extracted -> stored
+		Percentiles lockWait;
+
+		// stored -> uploaded
+		Percentiles upload;
+
+		// enqueued -> first drawn
+		Percentiles latency;
+
+		// summed over all extracted jobs
+		std::size_t numVertices;
+		std::size_t numTriangles;
+	};
+
+	/**
+	 * Create a record. If not enabled, nothing is recorded and all methods
+	 * return without taking the lock.
+	 */
+	MeshExtractionStats(bool enabled = true) : _enabled(enabled), _queueDepth(0), _numRunning(0) {}
+
+	bool isEnabled() const { return _enabled; }
+
+	/**
+	 * Record the stages of the job for the given label and level of detail.
+	 * Stages after enqueued() are ignored for finished jobs.
+	 */
+	void enqueued(uint64_t label, float downsample);
+	void started(uint64_t label, float downsample);
+	void extracted(uint64_t label, float downsample, unsigned int numVertices, unsigned int numTriangles);
+	void stored(uint64_t label, float downsample);
+	void uploaded(uint64_t label, float downsample);
+
+	/**
+	 * Record that the given levels of detail were drawn. Only the first time is
+	 * kept, after which the job and the jobs of coarser levels of the same
+	 * label are finished.
+	 */
+	void drawn(const std::vector<std::pair<uint64_t, float>>& lods);
+
+	/**
+	 * Finish all unfinished jobs of a label that is not shown anymore.
+	 */
+	void hidden(uint64_t label);
+
+	/**
+	 * Get a copy of all unfinished jobs and the most recently finished ones.
+	 */
+	std::vector<Job> getJobs();
+
+	/**
+	 * The number of jobs that were enqueued but not started yet.
+	 */
+	std::size_t getQueueDepth();
+
+	/**
+	 * The number of jobs that were started but not extracted yet.
+	 */
+	std::size_t getNumRunning();
+
+	/**
+	 * Summarize the recorded jobs by level of detail.
+	 */
+	std::map<float, LodSummary> getSummary();
+
+	/**
+	 * A one-line human readable summary.
+	 */
+	std::string getSummaryString();
+
+private:
+
+	typedef std::pair<uint64_t, float> Key;
+
+	/**
+	 * Get the unfinished job for the given label and level of detail, or 0.
+	 */
+	Job* job(uint64_t label, float downsample);
+
+	/**
+	 * Move an unfinished job to the finished ones. Returns the next unfinished
+	 * job.
+	 */
+	std::map<Key, Job>::iterator retire(std::map<Key, Job>::iterator i);
+
+	const bool _enabled;
+
+	// jobs that were not drawn yet, ordered by label and level of detail
+	std::map<Key, Job> _jobs;
+
+	// the most recently finished jobs, oldest first
+	std::deque<Job> _finished;
+
+	std::size_t _queueDepth;
+	std::size_t _numRunning;
+
+	std::mutex _mutex;
+};
+
+} // namespace sg_gui
+
+#endif // SG_GUI_MESH_EXTRACTION_STATS_H__
+
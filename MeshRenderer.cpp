@@ -0,0 +1,260 @@
+#include <cstddef>
+#include <util/Logger.h>
+#include "MeshRenderer.h"
+
+logger::LogChannel meshrendererlog("meshrendererlog", "[MeshRenderer] ");
+
+namespace sg_gui {
+
+MeshRenderer::~MeshRenderer() {
+
+	// make sure we have a valid OpenGl context
+	OpenGl::Guard guard;
+
+	clear();
+	_arena.reset();
+}
+
+void
+MeshRenderer::upload(std::shared_ptr<Mesh> mesh) {
+
+	if (!_arena && MeshArena::isSupported())
+		_arena.reset(new MeshArena(_compact));
+
+	if (_arena && _arena->accepts(*mesh)) {
+
+		_arena->upload(mesh);
+		return;
+	}
+
+	GpuMesh& gpuMesh = _gpuMeshes[mesh];
+
+	deleteBuffers(gpuMesh);
+
+	unsigned int numVertices = mesh->getNumVertices();
+
+	LOG_ALL(meshrendererlog)
+			<< "uploading mesh with " << numVertices << " vertices and "
+			<< mesh->getNumTriangles() << " triangles" << std::endl;
+
+	if (_compact) {
+
+		uploadCompact(*mesh, gpuMesh);
+		return;
+	}
+
+	gpuMesh.numIndices    = 3*mesh->getNumTriangles();
+	gpuMesh.normalsOffset = numVertices*Mesh::PositionStride;
+
+	// positions followed by normals, straight from the mesh arrays
+	glCheck(glGenBuffers(1, &gpuMesh.vertexBuffer));
+	glCheck(glBindBuffer(GL_ARRAY_BUFFER, gpuMesh.vertexBuffer));
+	glCheck(glBufferData(GL_ARRAY_BUFFER, numVertices*(Mesh::PositionStride + Mesh::NormalStride), 0, GL_STATIC_DRAW));
+	glCheck(glBufferSubData(GL_ARRAY_BUFFER, 0, gpuMesh.normalsOffset, mesh->getPositionData()));
+	glCheck(glBufferSubData(GL_ARRAY_BUFFER, gpuMesh.normalsOffset, numVertices*Mesh::NormalStride, mesh->getNormalData()));
+	glCheck(glBindBuffer(GL_ARRAY_BUFFER, 0));
+
+	glCheck(glGenBuffers(1, &gpuMesh.indexBuffer));
+	glCheck(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gpuMesh.indexBuffer));
+	glCheck(glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh->getNumTriangles()*Mesh::TriangleStride, mesh->getIndexData(), GL_STATIC_DRAW));
+	glCheck(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+}
+
+void
+MeshRenderer::uploadCompact(const Mesh& mesh, GpuMesh& gpuMesh) {
+
+	unsigned int numVertices = mesh.getNumVertices();
+
+	std::vector<CompactVertex> vertices;
+	encodeCompact(mesh, vertices, gpuMesh.positionOffset, gpuMesh.positionScale);
+
+	gpuMesh.compact    = true;
+	gpuMesh.numIndices = 3*mesh.getNumTriangles();
+
+	glCheck(glGenBuffers(1, &gpuMesh.vertexBuffer));
+	glCheck(glBindBuffer(GL_ARRAY_BUFFER, gpuMesh.vertexBuffer));
+	glCheck(glBufferData(GL_ARRAY_BUFFER, vertices.size()*sizeof(CompactVertex), vertices.data(), GL_STATIC_DRAW));
+	glCheck(glBindBuffer(GL_ARRAY_BUFFER, 0));
+
+	glCheck(glGenBuffers(1, &gpuMesh.indexBuffer));
+	glCheck(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gpuMesh.indexBuffer));
+
+	if (numVertices <= 65536) {
+
+		std::vector<uint16_t> indices(mesh.getIndexData(), mesh.getIndexData() + gpuMesh.numIndices);
+
+		gpuMesh.indexType = GL_UNSIGNED_SHORT;
+		glCheck(glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size()*sizeof(uint16_t), indices.data(), GL_STATIC_DRAW));
+
+	} else {
+
+		gpuMesh.indexType = GL_UNSIGNED_INT;
+		glCheck(glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.getNumTriangles()*Mesh::TriangleStride, mesh.getIndexData(), GL_STATIC_DRAW));
+	}
+
+	glCheck(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+}
+
+void
+MeshRenderer::free(std::shared_ptr<Mesh> mesh) {
+
+	if (_arena)
+		_arena->free(mesh);
+
+	auto i = _gpuMeshes.find(mesh);
+
+	if (i == _gpuMeshes.end())
+		return;
+
+	deleteBuffers(i->second);
+	_gpuMeshes.erase(i);
+}
+
+void
+MeshRenderer::clear() {
+
+	for (auto& p : _gpuMeshes)
+		deleteBuffers(p.second);
+
+	_gpuMeshes.clear();
+
+	if (_arena)
+		_arena->clear();
+}
+
+std::vector<std::shared_ptr<Mesh>>
+MeshRenderer::getUploaded() const {
+
+	std::vector<std::shared_ptr<Mesh>> meshes;
+	meshes.reserve(_gpuMeshes.size());
+
+	for (auto& p : _gpuMeshes)
+		meshes.push_back(p.first);
+
+	if (_arena)
+		for (std::shared_ptr<Mesh> mesh : _arena->getMeshes())
+			meshes.push_back(mesh);
+
+	return meshes;
+}
+
+void
+MeshRenderer::draw(std::shared_ptr<Mesh> mesh, ShaderProgram* program) const {
+
+	if (_arena && _arena->contains(mesh)) {
+
+		if (program)
+			program->setUniform("compact", _arena->isCompact());
+
+		_arena->draw(std::vector<std::shared_ptr<Mesh>>(1, mesh), program);
+		return;
+	}
+
+	auto i = _gpuMeshes.find(mesh);
+
+	if (i == _gpuMeshes.end())
+		return;
+
+	const GpuMesh& gpuMesh = i->second;
+
+	if (program)
+		program->setUniform("compact", gpuMesh.compact);
+
+	if (gpuMesh.compact && !program)
+		UTIL_THROW_EXCEPTION(
+				OpenGlError,
+				"compact meshes can only be drawn with a decoding shader program");
+
+	GLint octNormal = -1;
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glCheck(glBindBuffer(GL_ARRAY_BUFFER, gpuMesh.vertexBuffer));
+
+	if (gpuMesh.compact) {
+
+		// the same for all vertices
+		GLint positionOffset = program->getAttributeLocation("positionOffset");
+		GLint positionScale  = program->getAttributeLocation("positionScale");
+		if (positionOffset >= 0)
+			glVertexAttrib3fv(positionOffset, gpuMesh.positionOffset);
+		if (positionScale >= 0)
+			glVertexAttrib3fv(positionScale, gpuMesh.positionScale);
+
+		glVertexPointer(3, GL_SHORT, sizeof(CompactVertex), 0);
+
+		octNormal = program->getAttributeLocation("octNormal");
+		if (octNormal >= 0) {
+
+			glEnableVertexAttribArray(octNormal);
+			glVertexAttribPointer(octNormal, 2, GL_SHORT, GL_TRUE, sizeof(CompactVertex), reinterpret_cast<const GLvoid*>(offsetof(CompactVertex, normal)));
+		}
+
+	} else {
+
+		glEnableClientState(GL_NORMAL_ARRAY);
+		glVertexPointer(Mesh::Components, GL_FLOAT, Mesh::PositionStride, 0);
+		glNormalPointer(GL_FLOAT, Mesh::NormalStride, reinterpret_cast<const GLvoid*>(gpuMesh.normalsOffset));
+	}
+
+	glCheck(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gpuMesh.indexBuffer));
+	glCheck(glDrawElements(GL_TRIANGLES, gpuMesh.numIndices, gpuMesh.indexType, 0));
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	if (octNormal >= 0)
+		glDisableVertexAttribArray(octNormal);
+
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+void
+MeshRenderer::draw(
+		const std::vector<std::shared_ptr<Mesh>>& meshes,
+		const std::vector<MeshColor>&             colors,
+		ShaderProgram*                            program) {
+
+	_batch.clear();
+
+	// for meshes drawn one by one, the arena sets it per mesh
+	GLint meshColor = (program ? program->getAttributeLocation("meshColor") : -1);
+
+	for (std::size_t i = 0; i < meshes.size(); i++) {
+
+		if (_arena && _arena->contains(meshes[i])) {
+
+			_arena->setColor(meshes[i], colors[i]);
+			_batch.push_back(meshes[i]);
+
+		} else {
+
+			glColor3ub(colors[i].r, colors[i].g, colors[i].b);
+			if (meshColor >= 0)
+				glVertexAttrib4Nub(meshColor, colors[i].r, colors[i].g, colors[i].b, 255);
+
+			draw(meshes[i], program);
+		}
+	}
+
+	if (_batch.empty())
+		return;
+
+	if (program)
+		program->setUniform("compact", _arena->isCompact());
+
+	_arena->draw(_batch, program);
+}
+
+void
+MeshRenderer::deleteBuffers(GpuMesh& gpuMesh) {
+
+	if (gpuMesh.vertexBuffer != 0)
+		glCheck(glDeleteBuffers(1, &gpuMesh.vertexBuffer));
+	if (gpuMesh.indexBuffer != 0)
+		glCheck(glDeleteBuffers(1, &gpuMesh.indexBuffer));
+
+	gpuMesh = GpuMesh();
+}
+
+} // namespace sg_gui
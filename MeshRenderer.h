@@ -0,0 +1,150 @@
+#ifndef SG_GUI_MESH_RENDERER_H__
+#define SG_GUI_MESH_RENDERER_H__
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+#include "OpenGl.h"
+#include "CompactVertex.h"
+#include "Mesh.h"
+#include "MeshArena.h"
+#include "ShaderProgram.h"
+
+namespace sg_gui {
+
+/**
+ * Keeps the geometry of meshes in vertex and index buffer objects on the GPU.
+ * If supported, meshes are sub-allocated from a shared MeshArena, such that 
+ * all of them can be drawn with a single call. Otherwise, and for meshes the 
+ * arena does not accept, each mesh has its own buffers.
+ *
+ * Meshes can be kept in the compact encoding of CompactVertex, with 16 bit 
+ * indices for meshes of at most 2^16 vertices, which needs half of the GPU 
+ * memory. This saves GPU memory only, the meshes in main memory stay as 
+ * they are. Compact meshes have to be decoded in the vertex shader of the 
+ * program passed to draw(), which has to declare
+ *
+ *   uniform bool compact;            // true for compact meshes
+ *   attribute vec3 positionOffset;   // decoded position is
+ *   attribute vec3 positionScale;    //   positionOffset + (gl_Vertex.xyz + 32768)*positionScale
+ *   attribute vec2 octNormal;        // octahedral normal in [-1,1]^2
+ *
+ * All methods have to be called with an active OpenGl context.
+ */
+class MeshRenderer {
+
+public:
+
+	/**
+	 * Create a renderer. If compact is true, meshes will be uploaded in the
+	 * compact encoding.
+	 */
+	MeshRenderer(bool compact = false) : _compact(compact) {}
+
+	/**
+	 * Frees all buffers.
+	 */
+	~MeshRenderer();
+
+	/**
+	 * Upload the vertices, normals, and triangles of the given mesh. If the
+	 * mesh was uploaded before, its buffers are replaced.
+	 */
+	void upload(std::shared_ptr<Mesh> mesh);
+
+	/**
+	 * Free the buffers of the given mesh.
+	 */
+	void free(std::shared_ptr<Mesh> mesh);
+
+	/**
+	 * Free the buffers of all meshes.
+	 */
+	void clear();
+
+	/**
+	 * Check whether the given mesh has been uploaded.
+	 */
+	bool isUploaded(std::shared_ptr<Mesh> mesh) const { return _gpuMeshes.count(mesh) || (_arena && _arena->contains(mesh)); }
+
+	/**
+	 * Get all currently uploaded meshes.
+	 */
+	std::vector<std::shared_ptr<Mesh>> getUploaded() const;
+
+	/**
+	 * Draw an uploaded mesh with a single call to glDrawElements. If given, 
+	 * the (bound) program receives the decoding parameters of the mesh. A 
+	 * program is required for compact meshes.
+	 */
+	void draw(std::shared_ptr<Mesh> mesh, ShaderProgram* program = 0) const;
+
+	/**
+	 * Draw uploaded meshes in the given colors. Meshes in the arena are drawn 
+	 * with a single call, all others one by one. The colors are passed as the 
+	 * current color and, if the given program declares it, as
+	 *
+	 *   attribute vec4 meshColor;
+	 *
+	 * which is the only way to color meshes of the arena individually.
+	 */
+	void draw(
+			const std::vector<std::shared_ptr<Mesh>>& meshes,
+			const std::vector<MeshColor>&             colors,
+			ShaderProgram*                            program = 0);
+
+private:
+
+	struct GpuMesh {
+
+		GpuMesh() :
+			vertexBuffer(0),
+			indexBuffer(0),
+			numIndices(0),
+			indexType(GL_UNSIGNED_INT),
+			normalsOffset(0),
+			compact(false) {}
+
+		// all positions, followed by all normals, or interleaved 
+		// CompactVertices
+		GLuint vertexBuffer;
+
+		// triangle indices
+		GLuint indexBuffer;
+
+		GLsizei numIndices;
+
+		// GL_UNSIGNED_INT or GL_UNSIGNED_SHORT
+		GLenum indexType;
+
+		// the offset of the first normal in the vertex buffer in bytes
+		std::size_t normalsOffset;
+
+		// decoding parameters of compact meshes
+		bool  compact;
+		float positionOffset[3];
+		float positionScale[3];
+	};
+
+	void uploadCompact(const Mesh& mesh, GpuMesh& gpuMesh);
+
+	void deleteBuffers(GpuMesh& gpuMesh);
+
+	// the meshes are kept alive while their buffers exist, such that the key
+	// can not be reused by another mesh
+	std::map<std::shared_ptr<Mesh>, GpuMesh> _gpuMeshes;
+
+	// the shared buffers, created on the first upload if supported
+	std::unique_ptr<MeshArena> _arena;
+
+	// the meshes of the arena to draw, kept to avoid allocations per frame
+	std::vector<std::shared_ptr<Mesh>> _batch;
+
+	bool _compact;
+};
+
+} // namespace sg_gui
+
+#endif // SG_GUI_MESH_RENDERER_H__
+
@@ -2,10 +2,12 @@
 #include "Colors.h"
 #include "MeshView.h"
 #include "MarchingCubes.h"
+#include "Frustum.h"
 #include <util/ProgramOptions.h>
 #include <util/Logger.h>
 #include <util/geometry.hpp>
 #include <fstream>
+#include <set>
 
 logger::LogChannel meshviewlog("meshviewlog", "[MeshView] ");
 
@@ -19,12 +21,151 @@ util::ProgramOption optionMaxNumThreads(
 		util::_description_text = "The maximal number of threads to use for mesh extraction.",
 		util::_default_value    = 10);
 
+util::ProgramOption optionLodPixelThreshold(
+		util::_long_name        = "lodPixelThreshold",
+		util::_description_text = "The coarsest level of detail of a mesh is drawn, whose marching cubes are at most this many pixels large on the screen.",
+		util::_default_value    = 4);
+
+util::ProgramOption optionCompactMeshes(
+		util::_long_name        = "compactMeshes",
+		util::_description_text = "Keep meshes on the GPU with quantized positions and normals and 16 bit indices, to fit about twice as many. Meshes in main memory are not affected.");
+
+util::ProgramOption optionNoVertexCacheOptimization(
+		util::_long_name        = "noVertexCacheOptimization",
+		util::_description_text = "Don't reorder the triangles and vertices of extracted meshes for the GPU vertex cache.");
+
+util::ProgramOption optionMeshStatsInterval(
+		util::_long_name        = "meshStatsInterval",
+		util::_description_text = "If larger than 0, log a summary of the mesh extraction timings (p50/p95) every that many seconds while drawing.",
+		util::_default_value    = 0);
+
+util::ProgramOption optionMeshExportFormat(
+		util::_long_name        = "meshExportFormat",
+		util::_description_text = "The file format for mesh exports (F8): ply (binary), stl (binary), or obj.",
+		util::_default_value    = "ply");
+
 namespace sg_gui {
 
+// Vertex shader for the meshes. Replicates the fixed function lighting with
+// color material for GL_LIGHT1 (see RotateView) and fades out vertices with
+// their distance to the alpha plane. Positions are in mesh coordinates, i.e.,
+// before the offset is applied, as is the alpha plane. Decodes compact meshes
+// (see MeshRenderer).
+static const char* meshVertexShader = R"(
+#version 120
+
+uniform bool  compact;
+attribute vec3 positionOffset;
+attribute vec3 positionScale;
+attribute vec2 octNormal;
+
+// the color of the mesh (see MeshRenderer)
+attribute vec4 meshColor;
+
+uniform float alpha;
+uniform bool  haveAlphaPlane;
+uniform vec3  alphaPlanePosition;
+uniform vec3  alphaPlaneNormal;
+uniform float alphaFalloff;
+uniform bool  lighting;
+
+varying vec4 color;
+
+float signNotZero(float x) {
+
+	return (x >= 0.0 ? 1.0 : -1.0);
+}
+
+vec3 octahedralDecode(vec2 o) {
+
+	vec3 n = vec3(o, 1.0 - abs(o.x) - abs(o.y));
+
+	if (n.z < 0.0)
+		n.xy = vec2(
+				(1.0 - abs(o.y))*signNotZero(o.x),
+				(1.0 - abs(o.x))*signNotZero(o.y));
+
+	return normalize(n);
+}
+
+void main() {
+
+	vec4 vertex = gl_Vertex;
+	vec3 normal = gl_Normal;
+
+	if (compact) {
+
+		vertex = vec4(positionOffset + (gl_Vertex.xyz + 32768.0)*positionScale, 1.0);
+		normal = octahedralDecode(octNormal);
+	}
+
+	gl_Position = gl_ModelViewProjectionMatrix*vertex;
+
+	color.rgb = meshColor.rgb;
+
+	if (lighting) {
+
+		vec3  n = normalize(gl_NormalMatrix*normal);
+		vec3  l = normalize(gl_LightSource[1].position.xyz);
+		float d = max(dot(n, l), 0.0);
+
+		color.rgb *=
+				gl_LightModel.ambient.rgb +
+				gl_LightSource[1].ambient.rgb +
+				d*gl_LightSource[1].diffuse.rgb;
+	}
+
+	color.a = alpha;
+
+	if (haveAlphaPlane)
+		color.a *= 1.0 - abs(dot(vertex.xyz - alphaPlanePosition, alphaPlaneNormal))*alphaFalloff;
+}
+)";
+
+static const char* meshFragmentShader = R"(
+#version 120
+
+varying vec4 color;
+
+void main() {
+
+	gl_FragColor = color;
+}
+)";
+
+// Fragment shader for weighted blended order-independent transparency (see 
+// OitBuffer). The weight favours close and opaque fragments (equation 10 of 
+// McGuire and Bavoil, 2013).
+static const char* meshOitFragmentShader = R"(
+#version 120
+
+varying vec4 color;
+
+void main() {
+
+	float z = gl_FragCoord.z;
+	float w =
+			clamp(
+					pow(min(1.0, color.a*10.0) + 0.01, 3.0)*1e8*pow(1.0 - z*0.9, 3.0),
+					1e-2,
+					3e3);
+
+	gl_FragData[0] = vec4(color.rgb*color.a*w, color.a);
+	gl_FragData[1] = vec4(color.a*w, 0.0, 0.0, 0.0);
+}
+)";
+
 MeshView::MeshView(std::shared_ptr<ExplicitVolume<uint64_t>> labels) :
 	_labels(labels),
 	_meshes(std::make_shared<Meshes>()),
+	_publishedCache(std::make_shared<MeshCache>()),
+	_renderer(optionCompactMeshes),
+	_meshesChanged(false),
 	_minCubeSize(optionCubeSize),
+	_lodPixelThreshold(optionLodPixelThreshold),
+	_optimizeVertexCache(!optionNoVertexCacheOptimization),
+	_stats(static_cast<double>(optionMeshStatsInterval) > 0),
+	_statsInterval(optionMeshStatsInterval),
 	_alpha(1.0),
 	_haveAlphaPlane(false),
 	_numThreads(0),
@@ -37,21 +178,37 @@ MeshView::setOffset(util::point<float, 3> offset) {
 }
 
 void
-MeshView::onSignal(DrawOpaque& /*draw*/) {
+MeshView::onSignal(DrawOpaque& signal) {
 
 	if (_alpha < 1.0)
 		return;
 
-	draw();
+	draw(signal);
+}
+
+void
+MeshView::onSignal(DrawTranslucent& signal) {
+
+	if (_alpha == 1.0 || _alpha == 0.0)
+		return;
+
+	// we will be drawn in the order-independent pass
+	if (signal.orderIndependent()) {
+
+		signal.setOrderIndependentContent();
+		return;
+	}
+
+	draw(signal);
 }
 
 void
-MeshView::onSignal(DrawTranslucent& /*draw*/) {
+MeshView::onSignal(DrawOrderIndependentTranslucent& signal) {
 
 	if (_alpha == 1.0 || _alpha == 0.0)
 		return;
 
-	draw();
+	draw(signal, true);
 }
 
 void
@@ -60,7 +217,7 @@ MeshView::onSignal(QuerySize& signal) {
 	if (!_meshes)
 		return;
 
-	signal.setSize(_meshes->getBoundingBox() + _offset);
+	signal.setSize(_meshes->getSnapshot()->getBoundingBox() + _offset);
 }
 
 void
@@ -69,7 +226,6 @@ MeshView::onSignal(ChangeAlpha& signal) {
 	_alpha = signal.alpha;
 	_haveAlphaPlane = false;
 
-	updateRecording();
 	send<ContentChanged>();
 }
 
@@ -81,7 +237,6 @@ MeshView::onSignal(SetAlphaPlane& signal) {
 	_alphaFalloff = signal.falloff;
 	_haveAlphaPlane = true;
 
-	updateRecording();
 	send<ContentChanged>();
 }
 
@@ -97,9 +252,10 @@ MeshView::onSignal(ShowSegment& signal) {
 
 		if (_meshCache.count(label)) {
 
-			_meshes->add(label, _meshCache[label]);
+			// the finest level of detail determines the size
+			_meshes->add(label, _meshCache.at(label)->begin()->second);
+			publish();
 
-			updateRecording();
 			send<ContentChanged>();
 
 			return;
@@ -114,6 +270,8 @@ MeshView::onSignal(ShowSegment& signal) {
 				std::packaged_task<std::shared_ptr<sg_gui::Mesh>()>(
 						[this, label, downsample]() {
 
+							this->_stats.started(label, downsample);
+
 							Adaptor adaptor(*this->_labels, label);
 							float cubeSize = this->_minCubeSize*downsample;
 
@@ -125,14 +283,29 @@ MeshView::onSignal(ShowSegment& signal) {
 									cubeSize,
 									cubeSize);
 
-							this->notifyMeshExtracted(mesh, label);
+							if (this->_optimizeVertexCache)
+								mesh->optimizeVertexCache();
+
+							// compute the bounding box and hierarchy here, 
+							// not while drawing
+							mesh->getBoundingBox();
+							mesh->buildBvh();
+
+							this->_stats.extracted(label, downsample, mesh->getNumVertices(), mesh->getNumTriangles());
+
+							this->notifyMeshExtracted(mesh, label, downsample);
 
 							return mesh;
 						}
 				);
 
-		if (downsample == 1)
-			_highresMeshFutures.push_back(extractMesh.get_future());
+		if (downsample == 1) {
+
+			LockGuard guard(*_meshes);
+			_highresMeshFutures[label] = extractMesh.get_future().share();
+		}
+
+		_stats.enqueued(label, downsample);
 
 		// don't overdo it...
 		while (_numThreads > _maxNumThreads)
@@ -150,32 +323,60 @@ MeshView::onSignal(HideSegment& signal) {
 	LockGuard guard(*_meshes);
 
 	_meshes->remove(signal.getId());
+	publish();
+
+	_stats.hidden(signal.getId());
 
-	updateRecording();
 	send<ContentChanged>();
 }
 
 void
-MeshView::notifyMeshExtracted(std::shared_ptr<sg_gui::Mesh> mesh, uint64_t label) {
+MeshView::notifyMeshExtracted(std::shared_ptr<sg_gui::Mesh> mesh, uint64_t label, float downsample) {
 
 	LockGuard guard(*_meshes);
 
-	LOG_USER(meshviewlog) << "finished mesh for " << label << std::endl;
+	_stats.stored(label, downsample);
+
+	LOG_USER(meshviewlog) << "finished mesh for " << label << " at downsampling " << downsample << std::endl;
+
+	// replace the levels of detail of this label only, published copies of 
+	// the cache keep sharing the previous ones
+	std::shared_ptr<Lods> lods = std::make_shared<Lods>();
+	if (_meshCache.count(label))
+		*lods = *_meshCache.at(label);
+	(*lods)[downsample] = mesh;
+	_meshCache[label] = lods;
+
+	_numThreads--;
 
 	// don't replace existing mesh with lower resolution mesh
 	if (_meshes->contains(label))
-		if (_meshes->get(label)->getNumVertices() > mesh->getNumVertices())
+		if (_meshes->get(label)->getNumVertices() > mesh->getNumVertices()) {
+
+			publish();
+			send<ContentChanged>();
 			return;
+		}
 
 	_meshes->add(label, mesh);
-	_meshCache[label] = mesh;
 
-	updateRecording();
+	publish();
+
 	send<ContentChanged>();
 
 	LOG_USER(meshviewlog) << "added mesh " << label << std::endl;
+}
 
-	_numThreads--;
+bool
+MeshView::getSegmentAt(const util::ray<float,3>& ray, uint64_t& id) {
+
+	LockGuard guard(*_meshes);
+
+	// meshes are drawn with an offset
+	util::ray<float,3> local(ray.position() - _offset, ray.direction());
+
+	float t;
+	return _meshes->intersect(local, id, t);
 }
 
 void
@@ -192,114 +393,278 @@ MeshView::onSignal(KeyDown& signal) {
 void
 MeshView::exportMeshes() {
 
-	std::vector<uint64_t> currentMeshIds;
-	std::vector<std::future<std::shared_ptr<sg_gui::Mesh>>> pendingFutures;
+	std::string format = optionMeshExportFormat.as<std::string>();
 
-	{
-		LockGuard guard(*_meshes);
+	if (format != "ply" && format != "stl" && format != "obj") {
 
-		// get all currently pending high-res mesh futures
-		std::swap(pendingFutures, _highresMeshFutures);
+		LOG_ERROR(meshviewlog) << "unknown mesh export format " << format << std::endl;
+		return;
 	}
 
-	LOG_USER(meshviewlog) << "waiting for all high-res meshes to complete..." << std::endl;
-
-	// make sure all pending high-res meshes are done
-	for (auto& future : pendingFutures)
-		future.get();
-
-	LOG_USER(meshviewlog) << "all high-res meshes completed" << std::endl;
+	if (!_exportPool)
+		_exportPool.reset(new ThreadPool());
 
 	LockGuard guard(*_meshes);
 
+	std::vector<uint64_t> currentMeshIds = _meshes->getMeshIds();
+
 	for (uint64_t id : currentMeshIds) {
 
-		LOG_USER(meshviewlog) << "exporting mesh " << id << std::endl;
+		std::shared_ptr<sg_gui::Mesh> current = _meshes->get(id);
+		std::shared_future<std::shared_ptr<sg_gui::Mesh>> highres;
+		if (_highresMeshFutures.count(id))
+			highres = _highresMeshFutures[id];
+
+		_exportPool->schedule([id, current, highres, format]() {
 
-		std::stringstream filename;
-		filename << "mesh_" << id << ".raw";
+			std::shared_ptr<sg_gui::Mesh> mesh = current;
 
-		std::ofstream file(filename.str().c_str());
-		std::shared_ptr<sg_gui::Mesh> mesh = _meshes->get(id);
+			// wait for the high-res mesh in the pool, not in the GUI
+			if (highres.valid()) {
 
-		for (int i = 0; i < mesh->getNumTriangles(); i++) {
+				try {
 
-			const sg_gui::Triangle& triangle = mesh->getTriangle(i);
+					mesh = highres.get();
 
-			for (const sg_gui::Point3d& v : {
-					mesh->getVertex(triangle.v0),
-					mesh->getVertex(triangle.v1),
-					mesh->getVertex(triangle.v2) }) {
+				} catch (std::exception& e) {
 
-				file << v.x() << " " << v.y() << " " << v.z() << " ";
+					LOG_ERROR(meshviewlog)
+							<< "high-res mesh " << id << " failed, exporting current mesh instead: "
+							<< e.what() << std::endl;
+				}
 			}
-			file << std::endl;
-		}
+
+			std::stringstream filename;
+			filename << "mesh_" << id << "." << format;
+
+			// nobody waits for this job, report all failures here
+			try {
+
+				std::ofstream file(filename.str().c_str(), std::ios::binary);
+
+				if (!file) {
+
+					LOG_ERROR(meshviewlog) << "could not open " << filename.str() << " for writing" << std::endl;
+					return;
+				}
+
+				if (format == "ply")
+					mesh->writePly(file);
+				else if (format == "stl")
+					mesh->writeStl(file);
+				else
+					mesh->writeObj(file);
+
+				file.close();
+
+				if (!file) {
+
+					LOG_ERROR(meshviewlog) << "failed to write mesh " << id << " to " << filename.str() << std::endl;
+					return;
+				}
+
+				LOG_USER(meshviewlog) << "exported mesh " << id << " to " << filename.str() << std::endl;
+
+			} catch (std::exception& e) {
+
+				LOG_ERROR(meshviewlog)
+						<< "failed to export mesh " << id << " to " << filename.str() << ": "
+						<< e.what() << std::endl;
+			}
+		});
 	}
+
+	LOG_USER(meshviewlog) << "exporting " << currentMeshIds.size() << " meshes in the background" << std::endl;
 }
 
 void
-MeshView::updateRecording() {
+MeshView::draw(DrawBase& signal, bool orderIndependent) {
 
 	if (!_meshes)
 		return;
 
-	LockGuard meshGuard(*_meshes);
-	OpenGl::Guard guard;
+	// clear the flag before taking the snapshots, such that a publish() in 
+	// between sets it again for the next draw
+	bool changed = _meshesChanged.exchange(false);
+
+	// draw without holding the lock, from snapshots of the meshes and their 
+	// levels of detail
+	std::shared_ptr<const MeshesSnapshot> meshes = _meshes->getSnapshot();
+	std::shared_ptr<const MeshCache>      cache  = std::atomic_load(&_publishedCache);
 
-	startRecording();
+	if (changed)
+		updateBuffers(*meshes, *cache);
+
+	std::unique_ptr<ShaderProgram>& shader = (orderIndependent ? _oitShader : _shader);
+
+	if (!shader)
+		shader.reset(
+				new ShaderProgram(
+						meshVertexShader,
+						orderIndependent ? meshOitFragmentShader : meshFragmentShader));
+
+	shader->bind();
+	setShaderUniforms(*shader);
 
 	glPushMatrix();
 	glTranslatef(_offset.x(), _offset.y(), _offset.z());
 
-	foreach (uint64_t id, _meshes->getMeshIds()) {
-
-		// colorize the mesh according to its id
-		unsigned char cr, cg, cb;
-		idToRgb(_meshes->getColor(id), cr, cg, cb);
-		float r = static_cast<float>(cr)/255.0;
-		float g = static_cast<float>(cg)/255.0;
-		float b = static_cast<float>(cb)/255.0;
-
-		const std::vector<Triangle>& triangles = _meshes->get(id)->getTriangles();
-
-		glBegin(GL_TRIANGLES);
-		foreach (const Triangle& triangle, triangles) {
-
-			const Point3d&  v0 = _meshes->get(id)->getVertex(triangle.v0);
-			const Point3d&  v1 = _meshes->get(id)->getVertex(triangle.v1);
-			const Point3d&  v2 = _meshes->get(id)->getVertex(triangle.v2);
-			const Vector3d& n0 = _meshes->get(id)->getNormal(triangle.v0);
-			const Vector3d& n1 = _meshes->get(id)->getNormal(triangle.v1);
-			const Vector3d& n2 = _meshes->get(id)->getNormal(triangle.v2);
-
-			setVertexAlpha(v0, r, g, b);
-			glNormal3f(n0.x(), n0.y(), n0.z()); glVertex3f(v0.x(), v0.y(), v0.z());
-			setVertexAlpha(v1, r, g, b);
-			glNormal3f(n1.x(), n1.y(), n1.z()); glVertex3f(v1.x(), v1.y(), v1.z());
-			setVertexAlpha(v2, r, g, b);
-			glNormal3f(n2.x(), n2.y(), n2.z()); glVertex3f(v2.x(), v2.y(), v2.z());
+	// the frustum of the signal's ROI in mesh coordinates, as set up by the 
+	// views above us
+	Frustum frustum;
+	unsigned int numCulled = 0;
+
+	float pixelsPerUnit = std::max(signal.resolution().x(), signal.resolution().y());
+
+	_drawn.clear();
+	_visible.clear();
+	_colorIds.clear();
+
+	foreach (uint64_t id, meshes->getMeshIds()) {
+
+		auto lods = cache->find(id);
+		if (lods == cache->end())
+			continue;
+
+		const auto& lod = selectLod(*lods->second, pixelsPerUnit);
+		const std::shared_ptr<Mesh>& mesh = lod.second;
+
+		if (!frustum.intersects(mesh->getBoundingBox())) {
+
+			numCulled++;
+			continue;
 		}
-		glEnd();
+
+		_visible.push_back(mesh);
+		_colorIds.push_back(static_cast<unsigned int>(meshes->getColor(id)));
+
+		if (_stats.isEnabled())
+			_drawn.push_back(std::make_pair(id, lod.first));
 	}
 
+	// colorize the meshes according to their ids
+	_rgba.resize(4*_colorIds.size());
+	_colors.resize(_colorIds.size());
+
+	idsToRgb(_colorIds.data(), _colorIds.size(), _rgba.data());
+
+	for (std::size_t i = 0; i < _colors.size(); i++) {
+
+		_colors[i].r = _rgba[4*i];
+		_colors[i].g = _rgba[4*i + 1];
+		_colors[i].b = _rgba[4*i + 2];
+	}
+
+	_renderer.draw(_visible, _colors, shader.get());
+
 	glPopMatrix();
 
-	stopRecording();
+	LOG_ALL(meshviewlog) << "culled " << numCulled << " meshes outside the view frustum" << std::endl;
+
+	if (_stats.isEnabled()) {
+
+		_stats.drawn(_drawn);
+
+		MeshExtractionStats::Clock::time_point now = MeshExtractionStats::Clock::now();
+
+		if (now - _lastStatsLog > std::chrono::duration<double>(_statsInterval)) {
+
+			LOG_USER(meshviewlog) << "extraction stats: " << _stats.getSummaryString() << std::endl;
+			_lastStatsLog = now;
+		}
+	}
+
+	shader->unbind();
 }
 
 void
-MeshView::setVertexAlpha(const Point3d& p, float r, float g, float b) {
+MeshView::publish() {
 
-	if (_haveAlphaPlane) {
+	_meshes->publish();
 
-		double alpha = 1.0 - std::abs(distance(_alphaPlane, util::point<float,3>(p.x(), p.y(), p.z()))*_alphaFalloff);
-		glColor4f(r, g, b, _alpha*alpha);
+	// copies the pointers to the levels of detail only
+	std::atomic_store(&_publishedCache, std::make_shared<const MeshCache>(_meshCache));
 
-	} else {
+	// after both snapshots are published, see draw()
+	_meshesChanged = true;
+}
 
-		glColor4f(r, g, b, _alpha);
-	}
+void
+MeshView::updateBuffers(const MeshesSnapshot& meshes, const MeshCache& cache) {
+
+	std::vector<uint64_t> ids;
+	foreach (uint64_t id, meshes.getMeshIds())
+		if (cache.count(id))
+			ids.push_back(id);
+
+	// keep all levels of detail of visible meshes on the GPU
+	std::set<std::shared_ptr<Mesh>> visible;
+	foreach (uint64_t id, ids)
+		for (auto& lod : *cache.at(id))
+			visible.insert(lod.second);
+
+	// free meshes that are not visible anymore
+	for (std::shared_ptr<Mesh> mesh : _renderer.getUploaded())
+		if (!visible.count(mesh))
+			_renderer.free(mesh);
+
+	// upload meshes that became visible
+	foreach (uint64_t id, ids)
+		for (auto& lod : *cache.at(id))
+			if (!_renderer.isUploaded(lod.second)) {
+
+				_renderer.upload(lod.second);
+				_stats.uploaded(id, lod.first);
+			}
+}
+
+const std::pair<const float, std::shared_ptr<sg_gui::Mesh>>&
+MeshView::selectLod(const Lods& lods, float pixelsPerUnit) {
+
+	// the levels are ordered from fine to coarse, start with the finest
+	auto selected = lods.begin();
+
+	// a mesh that is not larger than the threshold on the screen can't show 
+	// any more detail than its coarsest level
+	const util::box<float,3>& bb = selected->second->getBoundingBox();
+	float extent = std::max(bb.width(), std::max(bb.height(), bb.depth()));
+	if (extent*pixelsPerUnit <= _lodPixelThreshold)
+		return *lods.rbegin();
+
+	for (auto lod = lods.begin(); lod != lods.end(); lod++)
+		if (_minCubeSize*lod->first*pixelsPerUnit <= _lodPixelThreshold)
+			selected = lod;
+
+	return *selected;
+}
+
+void
+MeshView::setShaderUniforms(ShaderProgram& shader) {
+
+	shader.setUniform("alpha", static_cast<float>(_alpha));
+	shader.setUniform("haveAlphaPlane", _haveAlphaPlane);
+
+	// follow the fixed function pipeline, in case a surrounding view enabled 
+	// lighting
+	shader.setUniform("lighting", glIsEnabled(GL_LIGHTING) == GL_TRUE);
+
+	if (!_haveAlphaPlane)
+		return;
+
+	util::point<float,3> normal = _alphaPlane.normal();
+	normal /= util::length(normal);
+
+	shader.setUniform(
+			"alphaPlanePosition",
+			_alphaPlane.position().x(),
+			_alphaPlane.position().y(),
+			_alphaPlane.position().z());
+	shader.setUniform(
+			"alphaPlaneNormal",
+			normal.x(),
+			normal.y(),
+			normal.z());
+	shader.setUniform("alphaFalloff", static_cast<float>(_alphaFalloff));
 }
 
 } // namespace sg_gui
@@ -7,8 +7,12 @@
 #include "SegmentSignals.h"
 #include "ViewSignals.h"
 #include "KeySignals.h"
-#include "RecordableView.h"
 #include "Meshes.h"
+#include "MeshExtractionStats.h"
+#include "MeshRenderer.h"
+#include "ShaderProgram.h"
+#include "ThreadPool.h"
+#include <atomic>
 #include <future>
 #include <thread>
 
@@ -58,6 +62,7 @@ class MeshView :
 					HideSegment,
 					DrawOpaque,
 					DrawTranslucent,
+					DrawOrderIndependentTranslucent,
 					QuerySize,
 					ChangeAlpha,
 					SetAlphaPlane,
@@ -66,8 +71,7 @@ class MeshView :
 			sg::Provides<
 					ContentChanged
 			>
-		>,
-		public RecordableView {
+		> {
 
 public:
 
@@ -79,6 +83,8 @@ public:
 
 	void onSignal(DrawTranslucent& signal);
 
+	void onSignal(DrawOrderIndependentTranslucent& signal);
+
 	void onSignal(QuerySize& signal);
 
 	void onSignal(ChangeAlpha& signal);
@@ -91,26 +97,119 @@ public:
 
 	void onSignal(KeyDown& signal);
 
+	/**
+	 * Find the visible segment whose surface is hit first by the given ray, 
+	 * e.g., PointerSignal::ray in the coordinates of this view.
+	 *
+	 * @return true, if a segment was hit.
+	 */
+	bool getSegmentAt(const util::ray<float,3>& ray, uint64_t& id);
+
+	/**
+	 * Get timings and sizes of the mesh extraction jobs, to find out where 
+	 * segments spend their time before they appear.
+	 */
+	MeshExtractionStats& getExtractionStats() { return _stats; }
+
 private:
 
-	void notifyMeshExtracted(std::shared_ptr<sg_gui::Mesh> mesh, uint64_t label);
+	// the extracted levels of detail of a label, by downsampling factor
+	typedef std::map<float, std::shared_ptr<sg_gui::Mesh>> Lods;
 
-	void exportMeshes();
+	// the levels of detail of all labels, immutable once added, such that 
+	// copies of the cache share them
+	typedef std::map<uint64_t, std::shared_ptr<const Lods>> MeshCache;
 
-	void updateRecording();
+	void notifyMeshExtracted(std::shared_ptr<sg_gui::Mesh> mesh, uint64_t label, float downsample);
 
-	void setVertexAlpha(const Point3d& p, float r, float g, float b);
+	/**
+	 * Write all currently visible meshes to files, using the high-resolution 
+	 * meshes. The export runs in the background and does not wait for pending 
+	 * extractions.
+	 */
+	void exportMeshes();
+
+	void draw(DrawBase& signal, bool orderIndependent = false);
+
+	/**
+	 * Publish snapshots of the meshes and their levels of detail, to be drawn 
+	 * without holding the lock. Called by the writers after their 
+	 * modifications, while holding the lock of _meshes.
+	 */
+	void publish();
+
+	/**
+	 * Get the coarsest of the given levels of detail of a label whose cubes 
+	 * project to at most the LOD pixel threshold, or the finest one if none 
+	 * does. Returns the downsampling factor and the mesh.
+	 */
+	const std::pair<const float, std::shared_ptr<sg_gui::Mesh>>& selectLod(
+			const Lods& lods,
+			float pixelsPerUnit);
+
+	/**
+	 * Upload meshes that became visible and free the ones that got hidden.
+	 */
+	void updateBuffers(const MeshesSnapshot& meshes, const MeshCache& cache);
+
+	/**
+	 * Pass alpha, alpha plane, and falloff to the given (bound) mesh shader.
+	 */
+	void setShaderUniforms(ShaderProgram& shader);
 
 	std::shared_ptr<ExplicitVolume<uint64_t>> _labels;
 
 	std::shared_ptr<Meshes> _meshes;
 
-	std::map<uint64_t, std::shared_ptr<sg_gui::Mesh>> _meshCache;
+	// the levels of detail, modified under the lock of _meshes
+	MeshCache _meshCache;
+
+	// the levels of detail as of the last publish(), only accessed atomically
+	std::shared_ptr<const MeshCache> _publishedCache;
+
+	// the high-resolution meshes per label, possibly still being extracted
+	std::map<uint64_t, std::shared_future<std::shared_ptr<sg_gui::Mesh>>> _highresMeshFutures;
+
+	// background threads for mesh exports, created on the first export
+	std::unique_ptr<ThreadPool> _exportPool;
 
-	std::vector<std::future<std::shared_ptr<sg_gui::Mesh>>> _highresMeshFutures;
+	// the GPU buffers of all levels of detail of the visible meshes
+	MeshRenderer _renderer;
+
+	// the program to draw the meshes with, created on the first draw
+	std::unique_ptr<ShaderProgram> _shader;
+
+	// the same for order-independent transparency, writing to an OitBuffer
+	std::unique_ptr<ShaderProgram> _oitShader;
+
+	// the visible meshes of the current frame, their levels of detail and 
+	// colors, kept to avoid allocations per frame
+	std::vector<std::shared_ptr<sg_gui::Mesh>>  _visible;
+	std::vector<std::pair<uint64_t, float>>     _drawn;
+	std::vector<uint64_t>                       _colorIds;
+	std::vector<uint8_t>                        _rgba;
+	std::vector<MeshColor>                      _colors;
+
+	// set whenever a snapshot with added or removed meshes was published, 
+	// the buffers will be updated on the next draw
+	std::atomic<bool> _meshesChanged;
 
 	float _minCubeSize;
 
+	// the maximal size of a marching cube on the screen in pixels for a level 
+	// of detail to be drawn
+	float _lodPixelThreshold;
+
+	// reorder the triangles of extracted meshes for the vertex cache
+	bool _optimizeVertexCache;
+
+	// timings of the extraction jobs
+	MeshExtractionStats _stats;
+
+	// log a summary of the stats every that many seconds, if positive
+	double _statsInterval;
+	MeshExtractionStats::Clock::time_point _lastStatsLog;
+
 	double _alpha;
 	util::plane<float, 3> _alphaPlane;
 	double _alphaFalloff;
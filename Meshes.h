@@ -1,32 +1,134 @@
 #ifndef SG_GUI_MESHES_H__
 #define SG_GUI_MESHES_H__
 
+#include <atomic>
+#include <memory>
 #include <imageprocessing/Volume.h>
 #include <util/Lockable.h>
+#include "Bvh.h"
 #include "Mesh.h"
 
 namespace sg_gui {
 
+/**
+ * An immutable copy of the content of Meshes at one point in time.
+ */
+class MeshesSnapshot {
+
+public:
+
+	const std::vector<uint64_t> getMeshIds() const {
+
+		std::vector<uint64_t> ids;
+		ids.reserve(_meshes.size());
+		for (auto& p : _meshes)
+			ids.push_back(p.first);
+		return ids;
+	}
+
+	std::shared_ptr<Mesh> get(uint64_t id) const {
+
+		auto i = _meshes.find(id);
+		if (i != _meshes.end())
+			return i->second;
+
+		return std::shared_ptr<Mesh>();
+	}
+
+	int getColor(uint64_t id) const {
+
+		auto i = _colors.find(id);
+		return (i == _colors.end() ? id : i->second);
+	}
+
+	bool contains(uint64_t id) const { return _meshes.count(id); }
+
+	const util::box<float,3>& getBoundingBox() const { return _boundingBox; }
+
+private:
+
+	friend class Meshes;
+
+	std::map<uint64_t, std::shared_ptr<Mesh> > _meshes;
+	std::map<uint64_t, int >                   _colors;
+	util::box<float,3>                         _boundingBox;
+};
+
+/**
+ * A collection of meshes by id. Modifications have to be done while holding 
+ * the lock. They become visible in snapshots, which can be read without 
+ * locking, after the writer calls publish().
+ */
 class Meshes : public Volume, public Lockable {
 
 public:
 
-	Meshes() {}
+	Meshes() : _boundingBoxStale(false), _bvhDirty(true), _modified(false), _snapshot(std::make_shared<MeshesSnapshot>()) {}
+
+	/**
+	 * Get the latest published snapshot. Does not need the lock, the 
+	 * snapshot stays valid and unchanged while it is held.
+	 */
+	std::shared_ptr<const MeshesSnapshot> getSnapshot() const {
+
+		return std::atomic_load(&_snapshot);
+	}
+
+	/**
+	 * Atomically replace the snapshot with a copy of the current content, if 
+	 * it was modified since the last call. Has to be called while holding the 
+	 * lock. Modifications don't publish on their own, such that a writer can 
+	 * batch any number of them into a single copy.
+	 */
+	void publish() {
+
+		if (!_modified)
+			return;
+
+		std::shared_ptr<MeshesSnapshot> snapshot = std::make_shared<MeshesSnapshot>();
+		snapshot->_meshes      = _meshes;
+		snapshot->_colors      = _colors;
+		snapshot->_boundingBox = getBoundingBox();
+
+		std::atomic_store(&_snapshot, std::shared_ptr<const MeshesSnapshot>(snapshot));
+
+		_modified = false;
+	}
 
 	void add(uint64_t id, std::shared_ptr<Mesh> mesh, int color = -1) {
 
+		auto i = _meshes.find(id);
+		if (i != _meshes.end())
+			shrinkBoundingBox(i->second->getBoundingBox());
+
 		_meshes[id] = mesh;
 		_colors[id] = (color < 0 ? id : color);
 
+		// grow the bounding box, unless it has to be recomputed anyway
+		if (!_boundingBoxStale)
+			_boundingBox += mesh->getBoundingBox();
+
 		setBoundingBoxDirty();
+		_bvhDirty = true;
+
+		_modified = true;
 	}
 
 	void remove(uint64_t id) {
 
-		_meshes.erase(id);
+		auto i = _meshes.find(id);
+		if (i == _meshes.end())
+			return;
+
+		shrinkBoundingBox(i->second->getBoundingBox());
+
+		_meshes.erase(i);
 		_colors.erase(id);
 
 		setBoundingBoxDirty();
+		_bvhDirty = true;
+
+		_modified = true;
 	}
 
 	std::shared_ptr<Mesh> get(uint64_t id) {
@@ -50,25 +152,123 @@ public:
 		return ids;
 	}
 
-	void clear() { _meshes.clear(); _colors.clear(); setBoundingBoxDirty(); }
+	void clear() { _meshes.clear(); _colors.clear(); _boundingBox = util::box<float,3>(); _boundingBoxStale = false; setBoundingBoxDirty(); _bvhDirty = true; _modified = true; }
+
+	/**
+	 * Find the mesh whose surface is hit first by a ray. Uses a hierarchy over 
+	 * the bounding boxes of the meshes, which is rebuilt on the first query 
+	 * after meshes were added or removed, and the hierarchies of the meshes 
+	 * themselves (see Mesh::buildBvh()).
+	 *
+	 * @param id
+	 *              Set to the id of the mesh hit.
+	 *
+	 * @param t
+	 *              Set to the ray parameter of the hit.
+	 *
+	 * @return true, if any mesh was hit.
+	 */
+	bool intersect(const util::ray<float,3>& ray, uint64_t& id, float& t) {
+
+		if (_bvhDirty) {
+
+			_bvhIds.clear();
+			_bvhMeshes.clear();
+
+			std::vector<float> bounds;
+			for (auto& p : _meshes) {
+
+				_bvhIds.push_back(p.first);
+				_bvhMeshes.push_back(p.second);
+
+				const util::box<float,3>& bb = p.second->getBoundingBox();
+				bounds.insert(bounds.end(), {
+						bb.min().x(), bb.min().y(), bb.min().z(),
+						bb.max().x(), bb.max().y(), bb.max().z() });
+			}
+
+			_bvh.build(bounds);
+			_bvhDirty = false;
+		}
+
+		unsigned int i;
+		bool hit = _bvh.intersect(
+				ray,
+				t,
+				i,
+				[this, &ray](unsigned int m, float& tm) {
+					unsigned int triangle;
+					return _bvhMeshes[m]->intersect(ray, tm, triangle);
+				});
+
+		if (hit)
+			id = _bvhIds[i];
+
+		return hit;
+	}
 
 	bool contains(uint64_t id) const { return _meshes.count(id); }
 
 private:
 
+	/**
+	 * The union of all mesh bounding boxes, maintained by add(). Walks all 
+	 * meshes only if a mesh on the boundary of the union was removed.
+	 */
 	util::box<float,3> computeBoundingBox() const {
 
-		util::box<float,3> boundingBox;
+		if (!_boundingBoxStale)
+			return _boundingBox;
+
+		_boundingBox = util::box<float,3>();
 
 		std::map<uint64_t, std::shared_ptr<Mesh> >::const_iterator i;
 		for (i = _meshes.begin(); i != _meshes.end(); i++)
-			boundingBox += i->second->getBoundingBox();
+			_boundingBox += i->second->getBoundingBox();
+
+		_boundingBoxStale = false;
 
-		return boundingBox;
+		return _boundingBox;
+	}
+
+	/**
+	 * Mark the union bounding box stale, if the given box of a removed mesh 
+	 * touches its boundary.
+	 */
+	void shrinkBoundingBox(const util::box<float,3>& box) {
+
+		if (_boundingBoxStale)
+			return;
+
+		if (box.min().x() <= _boundingBox.min().x() ||
+		    box.min().y() <= _boundingBox.min().y() ||
+		    box.min().z() <= _boundingBox.min().z() ||
+		    box.max().x() >= _boundingBox.max().x() ||
+		    box.max().y() >= _boundingBox.max().y() ||
+		    box.max().z() >= _boundingBox.max().z())
+			_boundingBoxStale = true;
 	}
 
 	std::map<uint64_t, std::shared_ptr<Mesh> > _meshes;
 	std::map<uint64_t, int >                   _colors;
+
+	// the union of the bounding boxes of all meshes, and whether it needs to 
+	// be recomputed
+	mutable util::box<float,3> _boundingBox;
+	mutable bool               _boundingBoxStale;
+
+	// hierarchy over the bounding boxes of the meshes, and the meshes in the 
+	// order of its primitives
+	Bvh                                _bvh;
+	std::vector<uint64_t>              _bvhIds;
+	std::vector<std::shared_ptr<Mesh>> _bvhMeshes;
+	bool                               _bvhDirty;
+
+	// content was modified since the last publish()
+	bool _modified;
+
+	// the latest published content, only accessed atomically
+	std::shared_ptr<const MeshesSnapshot> _snapshot;
 };
 
 } // namespace sg_gui
@@ -21,7 +21,7 @@ NormalsView::onSignal(sg_gui::QuerySize& signal) {
 	if (!_meshes)
 		return;
 
-	signal.setSize(_meshes->getBoundingBox());
+	signal.setSize(_meshes->getSnapshot()->getBoundingBox());
 }
 
 void
@@ -34,18 +34,22 @@ NormalsView::updateRecording() {
 	glEnable(GL_DEPTH_TEST);
 	glColor3f(0, 0, 0);
 
-	foreach (uint64_t id, _meshes->getMeshIds()) {
+	std::shared_ptr<const sg_gui::MeshesSnapshot> meshes = _meshes->getSnapshot();
 
-		const std::vector<sg_gui::Triangle>& triangles = _meshes->get(id)->getTriangles();
+	foreach (uint64_t id, meshes->getMeshIds()) {
 
-		foreach (const sg_gui::Triangle& triangle, triangles) {
+		std::shared_ptr<sg_gui::Mesh> mesh = meshes->get(id);
 
-			const sg_gui::Point3d&  v0 = _meshes->get(id)->getVertex(triangle.v0);
-			const sg_gui::Point3d&  v1 = _meshes->get(id)->getVertex(triangle.v1);
-			const sg_gui::Point3d&  v2 = _meshes->get(id)->getVertex(triangle.v2);
-			const sg_gui::Vector3d& n0 = 10.0f*_meshes->get(id)->getNormal(triangle.v0);
-			const sg_gui::Vector3d& n1 = 10.0f*_meshes->get(id)->getNormal(triangle.v1);
-			const sg_gui::Vector3d& n2 = 10.0f*_meshes->get(id)->getNormal(triangle.v2);
+		for (unsigned int i = 0; i < mesh->getNumTriangles(); i++) {
+
+			sg_gui::Triangle triangle = mesh->getTriangle(i);
+
+			sg_gui::Point3d  v0 = mesh->getVertex(triangle.v0);
+			sg_gui::Point3d  v1 = mesh->getVertex(triangle.v1);
+			sg_gui::Point3d  v2 = mesh->getVertex(triangle.v2);
+			sg_gui::Vector3d n0 = 10.0f*mesh->getNormal(triangle.v0);
+			sg_gui::Vector3d n1 = 10.0f*mesh->getNormal(triangle.v1);
+			sg_gui::Vector3d n2 = 10.0f*mesh->getNormal(triangle.v2);
 
 			glBegin(GL_LINES);
 			glVertex3f(v0.x(), v0.y(), v0.z()); glVertex3f(v0.x() + n0.x(), v0.y() + n0.y(), v0.z() + n0.z()); 
@@ -0,0 +1,211 @@
+#include <util/Logger.h>
+#include "OitBuffer.h"
+
+logger::LogChannel oitbufferlog("oitbufferlog", "[OitBuffer] ");
+
+namespace sg_gui {
+
+// Draws a screen filling quad and divides the accumulated colors by the
+// accumulated weights. The alpha of the result is 1 - revealage, such that the
+// standard blend function composites it over the opaque content.
+static const char* compositeVertexShader = R"(
+#version 120
+
+void main() {
+
+	gl_Position = gl_Vertex;
+}
+)";
+
+static const char* compositeFragmentShader = R"(
+#version 120
+
+uniform sampler2D accumulation;
+uniform sampler2D weight;
+uniform vec2      size;
+
+void main() {
+
+	vec2  uv        = gl_FragCoord.xy/size;
+	vec4  accum     = texture2D(accumulation, uv);
+	float revealage = accum.a;
+
+	// nothing translucent here
+	if (revealage == 1.0)
+		discard;
+
+	float w = max(texture2D(weight, uv).r, 1e-5);
+
+	gl_FragColor = vec4(accum.rgb/w, 1.0 - revealage);
+}
+)";
+
+bool
+OitBuffer::isSupported() {
+
+	return
+			GLEW_VERSION_2_0 &&
+			(GLEW_VERSION_3_0 || (GLEW_ARB_framebuffer_object && GLEW_ARB_texture_float));
+}
+
+OitBuffer::OitBuffer() :
+	_width(0),
+	_height(0),
+	_frameBuffer(0),
+	_accumulationTexture(0),
+	_weightTexture(0),
+	_depthTexture(0),
+	_previousFrameBuffer(0) {}
+
+OitBuffer::~OitBuffer() {
+
+	deleteBuffers();
+}
+
+void
+OitBuffer::resize(int width, int height) {
+
+	if (width == _width && height == _height)
+		return;
+
+	_width  = width;
+	_height = height;
+
+	deleteBuffers();
+	createBuffers();
+}
+
+void
+OitBuffer::begin() {
+
+	if (!_compositeShader)
+		_compositeShader.reset(new ShaderProgram(compositeVertexShader, compositeFragmentShader));
+
+	glCheck(glGetIntegerv(GL_FRAMEBUFFER_BINDING, &_previousFrameBuffer));
+
+	// the opaque depth, read from the current frame buffer
+	glCheck(glBindTexture(GL_TEXTURE_2D, _depthTexture));
+	glCheck(glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, _width, _height));
+	glCheck(glBindTexture(GL_TEXTURE_2D, 0));
+
+	glCheck(glPushAttrib(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_ENABLE_BIT));
+
+	glCheck(glBindFramebuffer(GL_FRAMEBUFFER, _frameBuffer));
+
+	// nothing accumulated, everything revealed
+	glCheck(glDrawBuffer(GL_COLOR_ATTACHMENT0));
+	glCheck(glClearColor(0, 0, 0, 1));
+	glCheck(glClear(GL_COLOR_BUFFER_BIT));
+	glCheck(glDrawBuffer(GL_COLOR_ATTACHMENT1));
+	glCheck(glClearColor(0, 0, 0, 0));
+	glCheck(glClear(GL_COLOR_BUFFER_BIT));
+
+	GLenum drawBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glCheck(glDrawBuffers(2, drawBuffers));
+
+	// test against, but don't write to, the opaque depth
+	glCheck(glEnable(GL_DEPTH_TEST));
+	glCheck(glDepthMask(GL_FALSE));
+
+	// add up colors and weights, multiply revealage (attachment 1 writes an
+	// alpha of 0 and is therefore unchanged in alpha)
+	glCheck(glEnable(GL_BLEND));
+	glCheck(glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ZERO, GL_ONE_MINUS_SRC_ALPHA));
+}
+
+void
+OitBuffer::end() {
+
+	glCheck(glBindFramebuffer(GL_FRAMEBUFFER, _previousFrameBuffer));
+
+	glCheck(glDisable(GL_DEPTH_TEST));
+	glCheck(glEnable(GL_BLEND));
+	glCheck(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+
+	glCheck(glActiveTexture(GL_TEXTURE1));
+	glCheck(glBindTexture(GL_TEXTURE_2D, _weightTexture));
+	glCheck(glActiveTexture(GL_TEXTURE0));
+	glCheck(glBindTexture(GL_TEXTURE_2D, _accumulationTexture));
+
+	_compositeShader->bind();
+	_compositeShader->setUniform("accumulation", 0);
+	_compositeShader->setUniform("weight", 1);
+	_compositeShader->setUniform("size", static_cast<float>(_width), static_cast<float>(_height));
+
+	// the vertex shader passes positions through, no need to touch the
+	// matrices
+	glBegin(GL_QUADS);
+	glVertex2f(-1, -1);
+	glVertex2f( 1, -1);
+	glVertex2f( 1,  1);
+	glVertex2f(-1,  1);
+	glCheck(glEnd());
+
+	_compositeShader->unbind();
+
+	glCheck(glActiveTexture(GL_TEXTURE1));
+	glCheck(glBindTexture(GL_TEXTURE_2D, 0));
+	glCheck(glActiveTexture(GL_TEXTURE0));
+	glCheck(glBindTexture(GL_TEXTURE_2D, 0));
+
+	glCheck(glPopAttrib());
+}
+
+void
+OitBuffer::createBuffers() {
+
+	LOG_DEBUG(oitbufferlog) << "creating buffers of size " << _width << "x" << _height << std::endl;
+
+	auto createTexture = [this](GLuint& texture, GLint internalFormat, GLenum format, GLenum type) {
+
+		glCheck(glGenTextures(1, &texture));
+		glCheck(glBindTexture(GL_TEXTURE_2D, texture));
+		glCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+		glCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+		glCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+		glCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+		glCheck(glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, _width, _height, 0, format, type, 0));
+	};
+
+	createTexture(_accumulationTexture, GL_RGBA16F, GL_RGBA, GL_FLOAT);
+	createTexture(_weightTexture, GL_RGBA16F, GL_RGBA, GL_FLOAT);
+	createTexture(_depthTexture, GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT);
+	glCheck(glBindTexture(GL_TEXTURE_2D, 0));
+
+	GLint previousFrameBuffer;
+	glCheck(glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFrameBuffer));
+
+	glCheck(glGenFramebuffers(1, &_frameBuffer));
+	glCheck(glBindFramebuffer(GL_FRAMEBUFFER, _frameBuffer));
+	glCheck(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _accumulationTexture, 0));
+	glCheck(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, _weightTexture, 0));
+	glCheck(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, _depthTexture, 0));
+
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+
+	glCheck(glBindFramebuffer(GL_FRAMEBUFFER, previousFrameBuffer));
+
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+		UTIL_THROW_EXCEPTION(
+				OpenGlError,
+				"frame buffer for order-independent transparency is incomplete, status " << status);
+}
+
+void
+OitBuffer::deleteBuffers() {
+
+	if (_frameBuffer) {
+
+		glCheck(glDeleteFramebuffers(1, &_frameBuffer));
+		_frameBuffer = 0;
+	}
+
+	for (GLuint* texture : { &_accumulationTexture, &_weightTexture, &_depthTexture })
+		if (*texture) {
+
+			glCheck(glDeleteTextures(1, texture));
+			*texture = 0;
+		}
+}
+
+} // namespace sg_gui
@@ -0,0 +1,92 @@
+#ifndef SG_GUI_OIT_BUFFER_H__
+#define SG_GUI_OIT_BUFFER_H__
+
+#include <memory>
+#include "OpenGl.h"
+#include "ShaderProgram.h"
+
+namespace sg_gui {
+
+/**
+ * Off-screen buffers for weighted blended order-independent transparency
+ * (McGuire and Bavoil, 2013).
+ *
+ * Translucent fragments are accumulated between begin() and end() into two
+ * floating point color attachments, in any order:
+ *
+ *   attachment 0: rgb = sum of premultiplied colors times weight, a = product
+ *                 of (1 - alpha), i.e., the revealage
+ *   attachment 1: r   = sum of alpha times weight
+ *
+ * To do so, fragment shaders have to write
+ *
+ *   gl_FragData[0] = vec4(color.rgb*color.a*w, color.a);
+ *   gl_FragData[1] = vec4(color.a*w, 0.0, 0.0, 0.0);
+ *
+ * for a depth dependent weight w. The blend function set up by begin() takes
+ * care of the rest. end() composites the weighted average color over the
+ * currently bound frame buffer.
+ *
+ * All methods (including construction and destruction) have to be called with
+ * the OpenGl context of the frame buffer to composite into.
+ */
+class OitBuffer {
+
+public:
+
+	/**
+	 * Check whether the current OpenGl context supports the required frame
+	 * buffer objects, floating point textures, and shaders.
+	 */
+	static bool isSupported();
+
+	OitBuffer();
+
+	~OitBuffer();
+
+	/**
+	 * Set the size of the buffers in pixels. Has to match the viewport.
+	 */
+	void resize(int width, int height);
+
+	/**
+	 * Start accumulating translucent fragments. Copies the depth buffer of the
+	 * current frame buffer, such that translucent fragments behind opaque
+	 * content get discarded.
+	 */
+	void begin();
+
+	/**
+	 * Stop accumulating and composite the result over the frame buffer that
+	 * was bound when begin() was called.
+	 */
+	void end();
+
+private:
+
+	void createBuffers();
+
+	void deleteBuffers();
+
+	int _width;
+	int _height;
+
+	GLuint _frameBuffer;
+
+	// the accumulated colors and revealage, and the accumulated weights
+	GLuint _accumulationTexture;
+	GLuint _weightTexture;
+
+	// a copy of the depth buffer after drawing the opaque content
+	GLuint _depthTexture;
+
+	// the frame buffer that was bound in begin()
+	GLint _previousFrameBuffer;
+
+	std::unique_ptr<ShaderProgram> _compositeShader;
+};
+
+} // namespace sg_gui
+
+#endif // SG_GUI_OIT_BUFFER_H__
+
@@ -1,6 +1,7 @@
 #ifndef SG_GUI_OPENGL_TRAITS_H__
 #define SG_GUI_OPENGL_TRAITS_H__
 
+#include <cstdint>
 #include <boost/array.hpp>
 
 #include <config.h>
@@ -36,6 +37,37 @@ struct pixel_type_traits<unsigned char> {
 	enum { gl_type = GL_UNSIGNED_BYTE };
 };
 
+template <>
+struct pixel_type_traits<int16_t> {
+
+	enum { gl_type = GL_SHORT };
+};
+
+template <>
+struct pixel_type_traits<uint16_t> {
+
+	enum { gl_type = GL_UNSIGNED_SHORT };
+};
+
+template <>
+struct pixel_type_traits<int32_t> {
+
+	enum { gl_type = GL_INT };
+};
+
+template <>
+struct pixel_type_traits<uint32_t> {
+
+	enum { gl_type = GL_UNSIGNED_INT };
+};
+
+template <>
+struct pixel_type_traits<uint64_t> {
+
+	// OpenGl does not support that -- consider using boost::array<uint32_t, 2>
+	// and a GL_RG32UI texture
+};
+
 template <>
 struct pixel_type_traits<double> {
 
@@ -102,6 +134,16 @@ struct pixel_format_traits<vigra::RGBValue<ValueType> > {
 	//enum { gl_type   = GL_UNSIGNED_BYTE };
 //};
 
+// specialisation: boost::array<???, 2>
+template <typename ValueType>
+struct pixel_format_traits<boost::array<ValueType, 2> > {
+
+	typedef ValueType value_type;
+
+	enum { gl_format = GL_RG };
+	enum { gl_type   = pixel_type_traits<value_type>::gl_type };
+};
+
 // specialisation: boost::array<???, 4>
 template <typename ValueType>
 struct pixel_format_traits<boost::array<ValueType, 4> > {
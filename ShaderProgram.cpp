@@ -0,0 +1,145 @@
+#include <vector>
+#include <util/Logger.h>
+#include "ShaderProgram.h"
+
+logger::LogChannel shaderprogramlog("shaderprogramlog", "[ShaderProgram] ");
+
+namespace sg_gui {
+
+ShaderProgram::ShaderProgram(const std::string& vertexSource, const std::string& fragmentSource) :
+	_program(0) {
+
+	GLuint vertexShader   = compile(GL_VERTEX_SHADER,   vertexSource);
+	GLuint fragmentShader = compile(GL_FRAGMENT_SHADER, fragmentSource);
+
+	_program = glCreateProgram();
+
+	glCheck(glAttachShader(_program, vertexShader));
+	glCheck(glAttachShader(_program, fragmentShader));
+	glCheck(glLinkProgram(_program));
+
+	// the shaders are deleted together with the program
+	glCheck(glDeleteShader(vertexShader));
+	glCheck(glDeleteShader(fragmentShader));
+
+	GLint linked;
+	glCheck(glGetProgramiv(_program, GL_LINK_STATUS, &linked));
+
+	if (!linked) {
+
+		GLint length;
+		glCheck(glGetProgramiv(_program, GL_INFO_LOG_LENGTH, &length));
+		std::vector<char> log(length + 1, 0);
+		glCheck(glGetProgramInfoLog(_program, length, 0, &log[0]));
+
+		glCheck(glDeleteProgram(_program));
+
+		UTIL_THROW_EXCEPTION(
+				OpenGlError,
+				"Couldn't link shader program: " << &log[0]);
+	}
+
+	LOG_ALL(shaderprogramlog) << "linked program " << _program << std::endl;
+}
+
+ShaderProgram::~ShaderProgram() {
+
+	// make sure we have a valid OpenGl context
+	OpenGl::Guard guard;
+
+	glCheck(glDeleteProgram(_program));
+}
+
+void
+ShaderProgram::bind() {
+
+	glCheck(glUseProgram(_program));
+}
+
+void
+ShaderProgram::unbind() {
+
+	glCheck(glUseProgram(0));
+}
+
+void
+ShaderProgram::setUniform(const std::string& name, int v) {
+
+	glCheck(glUniform1i(getUniformLocation(name), v));
+}
+
+void
+ShaderProgram::setUniform(const std::string& name, float v) {
+
+	glCheck(glUniform1f(getUniformLocation(name), v));
+}
+
+void
+ShaderProgram::setUniform(const std::string& name, float v0, float v1) {
+
+	glCheck(glUniform2f(getUniformLocation(name), v0, v1));
+}
+
+void
+ShaderProgram::setUniform(const std::string& name, float v0, float v1, float v2) {
+
+	glCheck(glUniform3f(getUniformLocation(name), v0, v1, v2));
+}
+
+void
+ShaderProgram::setUniform(const std::string& name, float v0, float v1, float v2, float v3) {
+
+	glCheck(glUniform4f(getUniformLocation(name), v0, v1, v2, v3));
+}
+
+GLint
+ShaderProgram::getUniformLocation(const std::string& name) {
+
+	auto i = _uniformLocations.find(name);
+
+	if (i != _uniformLocations.end())
+		return i->second;
+
+	// glUniform* with location -1 is a no-op
+	GLint location = glGetUniformLocation(_program, name.c_str());
+	_uniformLocations[name] = location;
+
+	return location;
+}
+
+GLint
+ShaderProgram::getAttributeLocation(const std::string& name) {
+
+	return glGetAttribLocation(_program, name.c_str());
+}
+
+GLuint
+ShaderProgram::compile(GLenum type, const std::string& source) {
+
+	GLuint shader = glCreateShader(type);
+
+	const char* s = source.c_str();
+	glCheck(glShaderSource(shader, 1, &s, 0));
+	glCheck(glCompileShader(shader));
+
+	GLint compiled;
+	glCheck(glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled));
+
+	if (!compiled) {
+
+		GLint length;
+		glCheck(glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length));
+		std::vector<char> log(length + 1, 0);
+		glCheck(glGetShaderInfoLog(shader, length, 0, &log[0]));
+
+		glCheck(glDeleteShader(shader));
+
+		UTIL_THROW_EXCEPTION(
+				OpenGlError,
+				"Couldn't compile " << (type == GL_VERTEX_SHADER ? "vertex" : "fragment") << " shader: " << &log[0]);
+	}
+
+	return shader;
+}
+
+} // namespace sg_gui
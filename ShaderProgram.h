@@ -0,0 +1,75 @@
+#ifndef SG_GUI_SHADER_PROGRAM_H__
+#define SG_GUI_SHADER_PROGRAM_H__
+
+#include <map>
+#include <string>
+#include "OpenGl.h"
+
+namespace sg_gui {
+
+/**
+ * A GLSL program consisting of a vertex and a fragment shader.
+ *
+ * All methods (including construction) have to be called with an active
+ * OpenGl context.
+ */
+class ShaderProgram {
+
+public:
+
+	/**
+	 * Compile and link a program from the given sources. Throws an OpenGlError
+	 * containing the info log if compilation or linking fails.
+	 */
+	ShaderProgram(const std::string& vertexSource, const std::string& fragmentSource);
+
+	/**
+	 * Deletes the program.
+	 */
+	~ShaderProgram();
+
+	/**
+	 * Use this program for subsequent draw calls.
+	 */
+	void bind();
+
+	/**
+	 * Return to the fixed function pipeline.
+	 */
+	void unbind();
+
+	/**
+	 * Set uniforms by name. The program has to be bound. Uniforms that are not
+	 * used by the program are silently ignored.
+	 */
+	void setUniform(const std::string& name, int v);
+	void setUniform(const std::string& name, float v);
+	void setUniform(const std::string& name, float v0, float v1);
+	void setUniform(const std::string& name, float v0, float v1, float v2);
+	void setUniform(const std::string& name, float v0, float v1, float v2, float v3);
+
+	/**
+	 * Get the location of a uniform, or -1 if the program does not use it.
+	 */
+	GLint getUniformLocation(const std::string& name);
+
+	/**
+	 * Get the location of a vertex attribute, or -1 if the program does not
+	 * use it.
+	 */
+	GLint getAttributeLocation(const std::string& name);
+
+private:
+
+	GLuint compile(GLenum type, const std::string& source);
+
+	GLuint _program;
+
+	// cached uniform locations
+	std::map<std::string, GLint> _uniformLocations;
+};
+
+} // namespace sg_gui
+
+#endif // SG_GUI_SHADER_PROGRAM_H__
+
@@ -4,15 +4,33 @@ namespace sg_gui {
 
 logger::LogChannel Texture::texturelog("texturelog", "[Texture] ");
 
-Texture::Texture(GLsizei width, GLsizei height, GLint format) :
+Texture::Texture(GLsizei width, GLsizei height, GLint format, bool mipmaps) :
 	_format(format),
 	_width(width),
 	_height(height),
-	_tex(0) {
+	_tex(0),
+	_immutable(false),
+	_mipmaps(mipmaps),
+	_levels(1) {
 
 	// make sure we have a valid OpenGl context
 	OpenGl::Guard guard;
 
+	create();
+}
+
+Texture::~Texture()
+{
+	// make sure we have a valid OpenGl context
+	OpenGl::Guard guard;
+
+	// delete texture
+	glCheck(glDeleteTextures(1, &_tex));
+}
+
+void
+Texture::create() {
+
 	// create the OpenGl texture
 	glCheck(glGenTextures(1, &_tex));
 
@@ -23,38 +41,217 @@ Texture::Texture(GLsizei width, GLsizei height, GLint format) :
 	glCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP));
 	glCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP));
 
-	// resize texture
-	resize(_width, _height);
+	allocate();
+
+	glCheck(glBindTexture(GL_TEXTURE_2D, 0));
 }
 
-Texture::~Texture()
-{
-	// make sure we have a valid OpenGl context
-	OpenGl::Guard guard;
+void
+Texture::allocate() {
 
-	// delete texture
-	glCheck(glDeleteTextures(1, &_tex));
+	_levels = 1;
+	if (_mipmaps)
+		while ((std::max(_width, _height) >> _levels) > 0)
+			_levels++;
+
+	GLint sized = sizedFormat(_format);
+
+	_immutable = (sized != 0 && (GLEW_VERSION_4_2 || GLEW_ARB_texture_storage));
+
+	if (_immutable) {
+
+		glCheck(glTexStorage2D(GL_TEXTURE_2D, _levels, sized, _width, _height));
+
+	} else {
+
+		// without data, any external format compatible with the internal one 
+		// will do
+		GLenum format = (isIntegerFormat(_format) ? GL_RED_INTEGER : GL_RGB);
+		GLenum type   = (isIntegerFormat(_format) ? GL_INT : GL_FLOAT);
+
+		for (unsigned int level = 0; level < _levels; level++)
+			glCheck(glTexImage2D(
+					GL_TEXTURE_2D, level, _format,
+					std::max(1, _width >> level), std::max(1, _height >> level),
+					0, format, type, 0));
+
+		glCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, _levels - 1));
+	}
+}
+
+GLint
+Texture::sizedFormat(GLint format) {
+
+	switch (format) {
+
+		case GL_RGB:
+		case GL_RGB8:
+			return GL_RGB8;
+
+		case GL_RGBA:
+		case GL_RGBA8:
+			return GL_RGBA8;
+
+		case GL_R8:
+		case GL_R16:
+		case GL_R16F:
+		case GL_R32F:
+		case GL_RG32F:
+		case GL_RGB32F:
+		case GL_RGBA32F:
+		case GL_R16I:
+		case GL_R16UI:
+		case GL_R32I:
+		case GL_R32UI:
+		case GL_RG32UI:
+			return format;
+
+		default:
+			// luminance and other legacy formats have no sized counterpart
+			return 0;
+	}
+}
+
+bool
+Texture::isIntegerFormat(GLint format) {
+
+	switch (format) {
+
+		case GL_R16I:
+		case GL_R16UI:
+		case GL_R32I:
+		case GL_R32UI:
+		case GL_RG32I:
+		case GL_RG32UI:
+		case GL_RGBA16UI:
+		case GL_RGBA32UI:
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+GLenum
+Texture::uploadFormat(GLenum format) const {
+
+	if (!isIntegerFormat(_format))
+		return format;
+
+	// integer textures can only be loaded from integer formats
+	switch (format) {
+
+		case GL_RED:
+		case GL_LUMINANCE:
+			return GL_RED_INTEGER;
+
+		case GL_RG:
+			return GL_RG_INTEGER;
+
+		case GL_RGB:
+			return GL_RGB_INTEGER;
+
+		case GL_RGBA:
+			return GL_RGBA_INTEGER;
+
+		case GL_BGRA:
+			return GL_BGRA_INTEGER;
+
+		default:
+			return format;
+	}
 }
 
 void
 Texture::resize(GLsizei width, GLsizei height) {
 
+	if (width == _width && height == _height)
+		return;
+
 	// make sure we have a valid OpenGl context
 	OpenGl::Guard guard;
 
 	_width  = width;
 	_height = height;
 
+	if (_immutable) {
+
+		glCheck(glDeleteTextures(1, &_tex));
+		create();
+		return;
+	}
+
 	// bind texture
 	glCheck(glBindTexture(GL_TEXTURE_2D, _tex));
 
 	// set size of texture
-	glCheck(glTexImage2D(GL_TEXTURE_2D, 0, _format, _width, _height, 0, GL_RGB, GL_FLOAT, 0));
+	allocate();
 
 	// unbind texture
 	glCheck(glBindTexture(GL_TEXTURE_2D, 0));
 }
 
+void
+Texture::loadLevel(unsigned int level, const GLvoid* data, GLint rowLength, GLenum format, GLenum type) {
+
+	// make sure we have a valid OpenGl context
+	OpenGl::Guard guard;
+
+	if (level >= _levels)
+		UTIL_THROW_EXCEPTION(
+				OpenGlError,
+				"texture has only " << _levels << " levels, can not load level " << level);
+
+	bind();
+
+	glCheck(glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT));
+	glCheck(glPixelStorei(GL_UNPACK_ALIGNMENT,  1));
+	glCheck(glPixelStorei(GL_UNPACK_ROW_LENGTH, rowLength));
+
+	glCheck(glTexSubImage2D(
+			GL_TEXTURE_2D, level, 0, 0,
+			std::max(1, _width >> level), std::max(1, _height >> level),
+			uploadFormat(format), type, data));
+
+	glCheck(glPopClientAttrib());
+
+	unbind();
+}
+
+void
+Texture::generateMipmaps() {
+
+	if (_levels == 1)
+		return;
+
+	if (isIntegerFormat(_format))
+		UTIL_THROW_EXCEPTION(
+				OpenGlError,
+				"mipmaps of integer textures can not be generated, use loadLevel() instead");
+
+	// make sure we have a valid OpenGl context
+	OpenGl::Guard guard;
+
+	bind();
+	glCheck(glGenerateMipmap(GL_TEXTURE_2D));
+	unbind();
+}
+
+bool
+Texture::canGenerateMipmaps() {
+
+	return GLEW_VERSION_3_0 || GLEW_ARB_framebuffer_object;
+}
+
+void
+Texture::setFilters(GLint minFilter, GLint magFilter) {
+
+	bind();
+	glCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter));
+	glCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, magFilter));
+	unbind();
+}
+
 void
 Texture::bind() {
 
@@ -69,6 +266,67 @@ Texture::unbind() {
 	glCheck(glBindTexture(GL_TEXTURE_2D, 0));
 }
 
+void
+Texture::setPixelTransfer(float scale, float bias) {
+
+	glCheck(glPixelTransferf(GL_RED_SCALE,   scale));
+	glCheck(glPixelTransferf(GL_GREEN_SCALE, scale));
+	glCheck(glPixelTransferf(GL_BLUE_SCALE,  scale));
+	glCheck(glPixelTransferf(GL_RED_BIAS,    bias));
+	glCheck(glPixelTransferf(GL_GREEN_BIAS,  bias));
+	glCheck(glPixelTransferf(GL_BLUE_BIAS,   bias));
+}
+
+void
+Texture::loadRawData(const GLvoid* data, GLenum format, GLenum type) {
+
+	// make sure we have a valid OpenGl context
+	OpenGl::Guard guard;
+
+	bind();
+
+	LOG_ALL(texturelog) << "loading raw texture data " << _width << "x" << _height << std::endl;
+
+	glCheck(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, _width, _height, uploadFormat(format), type, data));
+
+	unbind();
+}
+
+void
+Texture::loadRawData(
+		const GLvoid*                    data,
+		const util::box<unsigned int,2>& region,
+		GLint                            rowLength,
+		GLenum                           format,
+		GLenum                           type) {
+
+	// make sure we have a valid OpenGl context
+	OpenGl::Guard guard;
+
+	bind();
+
+	LOG_ALL(texturelog)
+			<< "loading raw texture data " << _width << "x" << _height
+			<< " within " << region << std::endl;
+
+	// let OpenGl skip the pixels outside the region
+	glCheck(glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT));
+	glCheck(glPixelStorei(GL_UNPACK_ALIGNMENT,   1));
+	glCheck(glPixelStorei(GL_UNPACK_ROW_LENGTH,  rowLength));
+	glCheck(glPixelStorei(GL_UNPACK_SKIP_PIXELS, region.min().x()));
+	glCheck(glPixelStorei(GL_UNPACK_SKIP_ROWS,   region.min().y()));
+
+	glCheck(glTexSubImage2D(
+			GL_TEXTURE_2D, 0,
+			region.min().x(), region.min().y(),
+			region.width(), region.height(),
+			uploadFormat(format), type, data));
+
+	glCheck(glPopClientAttrib());
+
+	unbind();
+}
+
 void
 Texture::loadData(const Buffer& buffer, int xoffset, int yoffset, float scale, float bias) {
 
@@ -95,13 +353,11 @@ Texture::loadData(const Buffer& buffer, int xoffset, int yoffset, float scale, f
 	// bind buffer
 	buffer.bind();
 
-	// set color/intensity scale and bias
-	glCheck(glPixelTransferf(GL_RED_SCALE,   scale));
-	glCheck(glPixelTransferf(GL_GREEN_SCALE, scale));
-	glCheck(glPixelTransferf(GL_BLUE_SCALE,  scale));
-	glCheck(glPixelTransferf(GL_RED_BIAS,    bias));
-	glCheck(glPixelTransferf(GL_GREEN_BIAS,  bias));
-	glCheck(glPixelTransferf(GL_BLUE_BIAS,   bias));
+	// set color/intensity scale and bias, only if needed (any pixel transfer 
+	// operation is likely to force the driver onto a slow conversion path)
+	bool transfer = (scale != 1.0f || bias != 0.0f);
+	if (transfer)
+		setPixelTransfer(scale, bias);
 
 	// update texture
 	LOG_ALL(texturelog)
@@ -109,15 +365,11 @@ Texture::loadData(const Buffer& buffer, int xoffset, int yoffset, float scale, f
 			<< _width << "x" << _height << ", buffer is "
 			<< buffer.width() << "x" << buffer.height()
 			<< " and offset is (" << xoffset << ", " << yoffset << ")" << std::endl;
-	glCheck(glTexSubImage2D(GL_TEXTURE_2D, 0, xoffset, yoffset, buffer.width(), buffer.height(), buffer.getFormat(), buffer.getType(), 0));
-
-	// set color/intensity scale and bias
-	glCheck(glPixelTransferf(GL_RED_SCALE,   1.0));
-	glCheck(glPixelTransferf(GL_GREEN_SCALE, 1.0));
-	glCheck(glPixelTransferf(GL_BLUE_SCALE,  1.0));
-	glCheck(glPixelTransferf(GL_RED_BIAS,    0.0));
-	glCheck(glPixelTransferf(GL_GREEN_BIAS,  0.0));
-	glCheck(glPixelTransferf(GL_BLUE_BIAS,   0.0));
+	glCheck(glTexSubImage2D(GL_TEXTURE_2D, 0, xoffset, yoffset, buffer.width(), buffer.height(), uploadFormat(buffer.getFormat()), buffer.getType(), 0));
+
+	// reset color/intensity scale and bias
+	if (transfer)
+		setPixelTransfer(1.0f, 0.0f);
 
 	// unbind texture
 	unbind();
@@ -26,9 +26,11 @@ public:
 	 * @param width The width of the texture.
 	 * @param height The height of the texture.
 	 * @param format The internal format of the texture (GL_RGB[A],
-	 *               GL_LUMINANCE, ...)
+	 *               GL_LUMINANCE, GL_R16, GL_R32UI, ...)
+	 * @param mipmaps Allocate a full chain of mipmap levels. They have to be 
+	 *                filled with generateMipmaps() or loadLevel().
 	 */
-	Texture(GLsizei data_width, GLsizei data_height, GLint format);
+	Texture(GLsizei data_width, GLsizei data_height, GLint format, bool mipmaps = false);
 
 	/**
 	 * Frees the texture and pixel buffer object.
@@ -97,6 +99,94 @@ public:
 	 */
 	void loadData(const Buffer& buffer, int offsetx = 0, int offsety = 0, float scale = 1.0f, float bias = 0.0f);
 
+	/**
+	 * Load texture data as it is, without scaling or conversion on the 
+	 * client side.
+	 *
+	 * @param data
+	 *             A pointer to width*height pixels.
+	 *
+	 * @param format
+	 *             The OpenGl format of the pixels (GL_RED, GL_RGBA, ...).
+	 *
+	 * @param type
+	 *             The OpenGl type of the pixel values (GL_FLOAT, ...).
+	 */
+	void loadRawData(const GLvoid* data, GLenum format, GLenum type);
+
+	/**
+	 * Load a region of the texture as it is from a larger image in client 
+	 * memory, without copying the region out of the image first.
+	 *
+	 * @param data
+	 *             A pointer to the first pixel of the image.
+	 *
+	 * @param region
+	 *              The region of the texture to update, which is also the 
+	 *              region of the image to read from.
+	 *
+	 * @param rowLength
+	 *              The number of pixels per row of the image.
+	 *
+	 * @param format
+	 *             The OpenGl format of the pixels (GL_RED, GL_RGBA, ...).
+	 *
+	 * @param type
+	 *             The OpenGl type of the pixel values (GL_FLOAT, ...).
+	 */
+	void loadRawData(
+			const GLvoid*                    data,
+			const util::box<unsigned int,2>& region,
+			GLint                            rowLength,
+			GLenum                           format,
+			GLenum                           type);
+
+	/**
+	 * Load a mipmap level as it is.
+	 *
+	 * @param level
+	 *             The mipmap level, of size max(1, width>>level) x 
+	 *             max(1, height>>level).
+	 *
+	 * @param data
+	 *             A pointer to the first pixel of the level.
+	 *
+	 * @param rowLength
+	 *             The number of pixels per row of data, which can be more 
+	 *             than the width of the level.
+	 *
+	 * @param format
+	 *             The OpenGl format of the pixels (GL_RED, GL_RGBA, ...).
+	 *
+	 * @param type
+	 *             The OpenGl type of the pixel values (GL_FLOAT, ...).
+	 */
+	void loadLevel(unsigned int level, const GLvoid* data, GLint rowLength, GLenum format, GLenum type);
+
+	/**
+	 * Compute all mipmap levels from the first one on the GPU. Not possible 
+	 * for integer textures.
+	 */
+	void generateMipmaps();
+
+	/**
+	 * Check whether the current OpenGl context can generate mipmaps.
+	 */
+	static bool canGenerateMipmaps();
+
+	/**
+	 * Check whether an internal format stores unnormalized integers (GL_R16UI, 
+	 * GL_R32UI, GL_RG32UI, ...). Those have to be read with integer samplers 
+	 * and can only be filtered with GL_NEAREST.
+	 */
+	static bool isIntegerFormat(GLint format);
+
+	/**
+	 * Set the minification and magnification filters (GL_NEAREST, GL_LINEAR, 
+	 * GL_LINEAR_MIPMAP_LINEAR, ...). The default is GL_NEAREST for both.
+	 */
+	void setFilters(GLint minFilter, GLint magFilter);
+
 	/**
 	 * Bind this texture. Calls glBindTexture().
 	 */
@@ -108,7 +198,9 @@ public:
 	void unbind();
 
 	/**
-	 * Resize the texture, if needed.
+	 * Resize the texture, if needed. The content of the texture is undefined 
+	 * afterwards. Textures with immutable storage get a new OpenGl texture 
+	 * object.
 	 *
 	 * @param width The new width.
 	 * @param height The new height.
@@ -120,13 +212,63 @@ public:
 	 */
 	inline GLsizei width() const { return _width; };
 
+	/**
+	 * Get the external format to upload pixels of the given format with. For 
+	 * integer textures, this is the corresponding integer format (e.g., 
+	 * GL_RED_INTEGER for GL_RED). Use it for uploads that do not go through
+	 * loadData(), e.g., from a bound pixel buffer.
+	 */
+	GLenum uploadFormat(GLenum format) const;
+
 	/**
 	 * @return The height of the texture in pixels.
 	 */
 	inline GLsizei height() const { return _height; };
 
+	/**
+	 * @return The internal format of the texture.
+	 */
+	inline GLint format() const { return _format; };
+
+	/**
+	 * @return The number of mipmap levels, 1 if the texture has no mipmaps.
+	 */
+	inline unsigned int numLevels() const { return _levels; }
+
+	/**
+	 * @return Whether this texture was created with mipmaps.
+	 */
+	inline bool hasMipmaps() const { return _mipmaps; }
+
+	/**
+	 * @return Whether the storage of this texture was allocated with 
+	 *         glTexStorage2D().
+	 */
+	inline bool isImmutable() const { return _immutable; }
+
 private:
 
+	/**
+	 * Create the OpenGl texture object and allocate its storage.
+	 */
+	void create();
+
+	/**
+	 * Allocate the storage of the bound texture for its size and format.
+	 */
+	void allocate();
+
+	/**
+	 * Get the sized counterpart of an internal format, as needed for 
+	 * immutable storage, or 0 if there is none.
+	 */
+	static GLint sizedFormat(GLint format);
+
+	/**
+	 * Set the OpenGl pixel transfer scale and bias of the color channels.
+	 */
+	static void setPixelTransfer(float scale, float bias);
+
 	static logger::LogChannel texturelog;
 	
 	// the internal format
@@ -138,6 +280,15 @@ private:
 
 	// the internal OpenGL id of the texture
 	GLuint _tex;
+
+	// the storage was allocated with glTexStorage2D and cannot be resized
+	bool _immutable;
+
+	// allocate a full mipmap chain
+	bool _mipmaps;
+
+	// the number of allocated mipmap levels
+	unsigned int _levels;
 };
 
 /*****************
@@ -159,26 +310,26 @@ Texture::loadData(PixelType* data, float scale, float bias) {
 	// bind texture
 	bind();
 
-	// set color/intensity scale and bias
-	glCheck(glPixelTransferf(GL_RED_SCALE,   scale));
-	glCheck(glPixelTransferf(GL_GREEN_SCALE, scale));
-	glCheck(glPixelTransferf(GL_BLUE_SCALE,  scale));
-	glCheck(glPixelTransferf(GL_RED_BIAS,    bias));
-	glCheck(glPixelTransferf(GL_GREEN_BIAS,  bias));
-	glCheck(glPixelTransferf(GL_BLUE_BIAS,   bias));
+	// set color/intensity scale and bias, only if needed (any pixel transfer 
+	// operation is likely to force the driver onto a slow conversion path)
+	bool transfer = (scale != 1.0f || bias != 0.0f);
+	if (transfer)
+		setPixelTransfer(scale, bias);
 
 	// update texture
 	LOG_ALL(texturelog) << "updating texture " << _width << "x" << _height << std::endl;
 
-	glCheck(glTexImage2D(GL_TEXTURE_2D, 0, _format, _width, _height, 0, format, type, data));
+	// rows are tightly packed, also for pixels of one or two bytes
+	glCheck(glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT));
+	glCheck(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
 
-	// set color/intensity scale and bias
-	glCheck(glPixelTransferf(GL_RED_SCALE,   1.0));
-	glCheck(glPixelTransferf(GL_GREEN_SCALE, 1.0));
-	glCheck(glPixelTransferf(GL_BLUE_SCALE,  1.0));
-	glCheck(glPixelTransferf(GL_RED_BIAS,    0.0));
-	glCheck(glPixelTransferf(GL_GREEN_BIAS,  0.0));
-	glCheck(glPixelTransferf(GL_BLUE_BIAS,   0.0));
+	glCheck(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, _width, _height, uploadFormat(format), type, data));
+
+	glCheck(glPopClientAttrib());
+
+	// reset color/intensity scale and bias
+	if (transfer)
+		setPixelTransfer(1.0f, 0.0f);
 
 	// unbind texture
 	unbind();
@@ -204,28 +355,28 @@ Texture::loadData(PixelType* data, const util::box<unsigned int,2>& region, floa
 	// bind texture
 	bind();
 
-	// set color/intensity scale and bias
-	glCheck(glPixelTransferf(GL_RED_SCALE,   scale));
-	glCheck(glPixelTransferf(GL_GREEN_SCALE, scale));
-	glCheck(glPixelTransferf(GL_BLUE_SCALE,  scale));
-	glCheck(glPixelTransferf(GL_RED_BIAS,    bias));
-	glCheck(glPixelTransferf(GL_GREEN_BIAS,  bias));
-	glCheck(glPixelTransferf(GL_BLUE_BIAS,   bias));
+	// set color/intensity scale and bias, only if needed (any pixel transfer 
+	// operation is likely to force the driver onto a slow conversion path)
+	bool transfer = (scale != 1.0f || bias != 0.0f);
+	if (transfer)
+		setPixelTransfer(scale, bias);
 
 	// update texture
 	LOG_ALL(texturelog)
 			<< "updating texture " << _width << "x" << _height
 			<< " within " << region << std::endl;
 
-	glCheck(glTexSubImage2D(GL_TEXTURE_2D, 0, xoffset, yoffset, width, height, format, type, data));
+	// rows are tightly packed, also for pixels of one or two bytes
+	glCheck(glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT));
+	glCheck(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+
+	glCheck(glTexSubImage2D(GL_TEXTURE_2D, 0, xoffset, yoffset, width, height, uploadFormat(format), type, data));
+
+	glCheck(glPopClientAttrib());
 
-	// set color/intensity scale and bias
-	glCheck(glPixelTransferf(GL_RED_SCALE,   1.0));
-	glCheck(glPixelTransferf(GL_GREEN_SCALE, 1.0));
-	glCheck(glPixelTransferf(GL_BLUE_SCALE,  1.0));
-	glCheck(glPixelTransferf(GL_RED_BIAS,    0.0));
-	glCheck(glPixelTransferf(GL_GREEN_BIAS,  0.0));
-	glCheck(glPixelTransferf(GL_BLUE_BIAS,   0.0));
+	// reset color/intensity scale and bias
+	if (transfer)
+		setPixelTransfer(1.0f, 0.0f);
 
 	// unbind texture
 	unbind();
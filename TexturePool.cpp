@@ -0,0 +1,189 @@
+#include <vector>
+#include <util/Logger.h>
+#include <util/ProgramOptions.h>
+#include "TexturePool.h"
+
+logger::LogChannel texturepoollog("texturepoollog", "[TexturePool] ");
+
+util::ProgramOption optionTexturePoolSize(
+		util::_long_name        = "texturePoolSize",
+		util::_description_text = "The memory of unused textures to keep for reuse in MB.",
+		util::_default_value    = 256);
+
+namespace sg_gui {
+
+std::shared_ptr<Texture>
+TexturePool::get(GLsizei width, GLsizei height, GLint format, bool mipmaps) {
+
+	TexturePool* pool = getInstance();
+	Key          key(width, height, format, mipmaps);
+	Texture*     texture = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(pool->_mutex);
+
+		auto i = pool->_byKey.find(key);
+
+		if (i != pool->_byKey.end()) {
+
+			texture = i->second->second;
+
+			pool->_unused.erase(i->second);
+			pool->_byKey.erase(i);
+			pool->_memory -= memory(key);
+		}
+	}
+
+	if (texture) {
+
+		LOG_ALL(texturepoollog)
+				<< "reusing texture " << width << "x" << height << std::endl;
+
+	} else {
+
+		LOG_ALL(texturepoollog)
+				<< "creating texture " << width << "x" << height << std::endl;
+
+		texture = new Texture(width, height, format, mipmaps);
+	}
+
+	return std::shared_ptr<Texture>(texture, [pool](Texture* t){ pool->release(t); });
+}
+
+void
+TexturePool::clear() {
+
+	TexturePool* pool = getInstance();
+
+	Unused unused;
+
+	{
+		std::lock_guard<std::mutex> lock(pool->_mutex);
+
+		unused.swap(pool->_unused);
+		pool->_byKey.clear();
+		pool->_memory = 0;
+	}
+
+	for (auto& entry : unused)
+		delete entry.second;
+}
+
+TexturePool::TexturePool() :
+	_memory(0) {
+
+	unsigned int maxMemory = optionTexturePoolSize;
+	_maxMemory = static_cast<std::size_t>(maxMemory)*1024*1024;
+}
+
+TexturePool*
+TexturePool::getInstance() {
+
+	// never destructed, textures might be released during static
+	// destruction
+	static TexturePool* pool = new TexturePool();
+
+	return pool;
+}
+
+void
+TexturePool::release(Texture* texture) {
+
+	Key key(texture->width(), texture->height(), texture->format(), texture->hasMipmaps());
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		_unused.push_front(std::make_pair(key, texture));
+		_byKey.insert(std::make_pair(key, _unused.begin()));
+		_memory += memory(key);
+	}
+
+	shrink();
+}
+
+void
+TexturePool::shrink() {
+
+	std::vector<Texture*> freed;
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		while (_memory > _maxMemory) {
+
+			const Key& key = _unused.back().first;
+
+			auto range = _byKey.equal_range(key);
+			for (auto i = range.first; i != range.second; i++)
+				if (i->second == std::prev(_unused.end())) {
+
+					_byKey.erase(i);
+					break;
+				}
+
+			_memory -= memory(key);
+			freed.push_back(_unused.back().second);
+			_unused.pop_back();
+		}
+	}
+
+	if (!freed.empty())
+		LOG_DEBUG(texturepoollog)
+				<< "freeing " << freed.size() << " unused textures" << std::endl;
+
+	// without holding the lock, since this needs the OpenGl context
+	for (Texture* texture : freed)
+		delete texture;
+}
+
+std::size_t
+TexturePool::memory(const Key& key) {
+
+	std::size_t bytesPerPixel;
+
+	switch (key.format) {
+
+		case GL_LUMINANCE:
+		case GL_R8:
+			bytesPerPixel = 1;
+			break;
+
+		case GL_R16:
+		case GL_R16F:
+		case GL_R16I:
+		case GL_R16UI:
+			bytesPerPixel = 2;
+			break;
+
+		case GL_RGB8:
+			bytesPerPixel = 3;
+			break;
+
+		case GL_RG32F:
+		case GL_RG32I:
+		case GL_RG32UI:
+		case GL_RGBA16UI:
+			bytesPerPixel = 8;
+			break;
+
+		case GL_RGB32F:
+			bytesPerPixel = 12;
+			break;
+
+		case GL_RGBA32F:
+		case GL_RGBA32UI:
+			bytesPerPixel = 16;
+			break;
+
+		default:
+			bytesPerPixel = 4;
+	}
+
+	std::size_t bytes = static_cast<std::size_t>(key.width)*key.height*bytesPerPixel;
+
+	// all mipmap levels together add about a third
+	return (key.mipmaps ? bytes + bytes/3 : bytes);
+}
+
+} // namespace sg_gui
@@ -0,0 +1,98 @@
+#ifndef SG_GUI_TEXTURE_POOL_H__
+#define SG_GUI_TEXTURE_POOL_H__
+
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include "Texture.h"
+
+namespace sg_gui {
+
+/**
+ * A pool of unused textures, keyed by size and internal format. Textures
+ * handed out by get() return to the pool when the last reference to them is
+ * released, such that views showing images of the same size (e.g., sections
+ * of a volume, or a view replacing another one) recycle textures instead of
+ * allocating new ones.
+ *
+ * Unused textures are kept up to a memory budget (--texturePoolSize), the
+ * least recently released ones are freed first.
+ */
+class TexturePool {
+
+public:
+
+	/**
+	 * Get a texture of the given size and internal format, with or without
+	 * mipmap levels. The content of the texture is undefined.
+	 */
+	static std::shared_ptr<Texture> get(GLsizei width, GLsizei height, GLint format, bool mipmaps = false);
+
+	/**
+	 * Free all unused textures.
+	 */
+	static void clear();
+
+private:
+
+	struct Key {
+
+		Key(GLsizei width_, GLsizei height_, GLint format_, bool mipmaps_) :
+			width(width_), height(height_), format(format_), mipmaps(mipmaps_) {}
+
+		bool operator<(const Key& other) const {
+
+			return
+					std::tie(width, height, format, mipmaps) <
+					std::tie(other.width, other.height, other.format, other.mipmaps);
+		}
+
+		GLsizei width;
+		GLsizei height;
+		GLint   format;
+		bool    mipmaps;
+	};
+
+	typedef std::list<std::pair<Key, Texture*> > Unused;
+
+	TexturePool();
+
+	static TexturePool* getInstance();
+
+	/**
+	 * Return a texture to the pool.
+	 */
+	void release(Texture* texture);
+
+	/**
+	 * Free the least recently released textures until the unused ones fit the
+	 * budget.
+	 */
+	void shrink();
+
+	/**
+	 * Estimate the memory of a texture in bytes.
+	 */
+	static std::size_t memory(const Key& key);
+
+	std::mutex _mutex;
+
+	// unused textures, most recently released first
+	Unused _unused;
+
+	// the unused textures by their key
+	std::multimap<Key, Unused::iterator> _byKey;
+
+	// the memory of all unused textures in bytes
+	std::size_t _memory;
+
+	// the maximal memory of all unused textures in bytes
+	std::size_t _maxMemory;
+};
+
+} // namespace sg_gui
+
+#endif // SG_GUI_TEXTURE_POOL_H__
+
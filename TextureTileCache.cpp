@@ -0,0 +1,62 @@
+#include "TextureTileCache.h"
+
+logger::LogChannel texturetilecachelog("texturetilecachelog", "[TextureTileCache] ");
+
+namespace sg_gui {
+
+Texture*
+TextureTileCache::get(const Key& key) {
+
+	auto i = _tiles.find(key);
+
+	if (i == _tiles.end())
+		return 0;
+
+	_order.splice(_order.begin(), _order, i->second.position);
+
+	return i->second.texture.get();
+}
+
+Texture*
+TextureTileCache::insert(const Key& key) {
+
+	if (Texture* texture = get(key))
+		return texture;
+
+	std::shared_ptr<Texture> texture;
+
+	if (_tiles.size() >= _capacity) {
+
+		// reuse the texture of the least recently used tile
+		auto evicted = _tiles.find(_order.back());
+		texture = std::move(evicted->second.texture);
+
+		LOG_ALL(texturetilecachelog)
+				<< "evicting tile (" << evicted->first.level << ", "
+				<< evicted->first.x << ", " << evicted->first.y << ")" << std::endl;
+
+		_tiles.erase(evicted);
+		_order.pop_back();
+
+	} else {
+
+		texture = TexturePool::get(_tileSize, _tileSize, _format);
+	}
+
+	_order.push_front(key);
+
+	Entry& entry   = _tiles[key];
+	entry.texture  = std::move(texture);
+	entry.position = _order.begin();
+
+	return entry.texture.get();
+}
+
+void
+TextureTileCache::clear() {
+
+	_tiles.clear();
+	_order.clear();
+}
+
+} // namespace sg_gui
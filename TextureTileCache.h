@@ -0,0 +1,93 @@
+#ifndef SG_GUI_TEXTURE_TILE_CACHE_H__
+#define SG_GUI_TEXTURE_TILE_CACHE_H__
+
+#include <list>
+#include <map>
+#include <memory>
+#include <tuple>
+#include "TexturePool.h"
+
+namespace sg_gui {
+
+/**
+ * A least-recently-used cache of square texture tiles, identified by their
+ * pyramid level and tile coordinates. Textures of evicted tiles are reused
+ * for new ones, such that at most a fixed number of textures exists. Textures 
+ * are taken from and returned to the TexturePool.
+ */
+class TextureTileCache {
+
+public:
+
+	struct Key {
+
+		Key(unsigned int level_, unsigned int x_, unsigned int y_) :
+			level(level_), x(x_), y(y_) {}
+
+		bool operator<(const Key& other) const {
+
+			return std::tie(level, x, y) < std::tie(other.level, other.x, other.y);
+		}
+
+		unsigned int level;
+		unsigned int x;
+		unsigned int y;
+	};
+
+	/**
+	 * Create a cache for at most capacity tiles of tileSize x tileSize pixels
+	 * in the given internal format.
+	 */
+	TextureTileCache(unsigned int tileSize, unsigned int capacity, GLint format = GL_RGBA) :
+		_tileSize(tileSize),
+		_capacity(std::max(capacity, 1u)),
+		_format(format) {}
+
+	/**
+	 * Get the texture of a cached tile and mark it as recently used. Returns 0
+	 * if the tile is not in the cache.
+	 */
+	Texture* get(const Key& key);
+
+	/**
+	 * Check whether a tile is in the cache, without marking it as used.
+	 */
+	bool contains(const Key& key) const { return _tiles.count(key); }
+
+	/**
+	 * Add a tile to the cache, evicting the least recently used one if the
+	 * cache is full. Returns the texture to fill with the content of the tile.
+	 */
+	Texture* insert(const Key& key);
+
+	/**
+	 * Remove all tiles and return their textures to the pool.
+	 */
+	void clear();
+
+	unsigned int getTileSize() const { return _tileSize; }
+
+	std::size_t size() const { return _tiles.size(); }
+
+private:
+
+	struct Entry {
+
+		std::shared_ptr<Texture>  texture;
+		std::list<Key>::iterator  position;
+	};
+
+	unsigned int _tileSize;
+	unsigned int _capacity;
+	GLint        _format;
+
+	// the keys of all cached tiles, most recently used first
+	std::list<Key> _order;
+
+	std::map<Key, Entry> _tiles;
+};
+
+} // namespace sg_gui
+
+#endif // SG_GUI_TEXTURE_TILE_CACHE_H__
+
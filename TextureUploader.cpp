@@ -0,0 +1,217 @@
+#include <algorithm>
+#include <util/Logger.h>
+#include "TextureUploader.h"
+
+logger::LogChannel textureuploaderlog("textureuploaderlog", "[TextureUploader] ");
+
+namespace sg_gui {
+
+namespace {
+
+std::size_t numComponents(GLenum format) {
+
+	switch (format) {
+
+		case GL_RG:
+		case GL_RG_INTEGER:
+		case GL_LUMINANCE_ALPHA:
+			return 2;
+
+		case GL_RGB:
+		case GL_RGB_INTEGER:
+		case GL_BGR:
+			return 3;
+
+		case GL_RGBA:
+		case GL_RGBA_INTEGER:
+		case GL_BGRA:
+		case GL_BGRA_INTEGER:
+			return 4;
+
+		default:
+			return 1;
+	}
+}
+
+std::size_t componentSize(GLenum type) {
+
+	switch (type) {
+
+		case GL_SHORT:
+		case GL_UNSIGNED_SHORT:
+		case GL_HALF_FLOAT:
+			return 2;
+
+		case GL_INT:
+		case GL_UNSIGNED_INT:
+		case GL_FLOAT:
+			return 4;
+
+		default:
+			return 1;
+	}
+}
+
+} // anonymous namespace
+
+bool
+TextureUploader::isSupported() {
+
+	return GLEW_VERSION_3_2 || (GLEW_ARB_map_buffer_range && GLEW_ARB_sync);
+}
+
+TextureUploader::TextureUploader(
+		GLsizei      width,
+		GLsizei      height,
+		GLenum       format,
+		GLenum       type,
+		unsigned int numBuffers) :
+	_width(width),
+	_height(height),
+	_format(format),
+	_type(type),
+	_size(static_cast<std::size_t>(width)*height*numComponents(format)*componentSize(type)),
+	_useFences(isSupported()),
+	_slots(std::max(numBuffers, 1u)),
+	_next(0) {
+
+	LOG_DEBUG(textureuploaderlog)
+			<< "using up to " << _slots.size() << " buffers of " << _size << " bytes"
+			<< (_useFences ? " with fences" : " with orphaning") << std::endl;
+}
+
+TextureUploader::~TextureUploader() {
+
+	// make sure we have a valid OpenGl context
+	OpenGl::Guard guard;
+
+	for (Slot& slot : _slots) {
+
+		// never mapped
+		if (!slot.buffer)
+			continue;
+
+		if (slot.data) {
+
+			glCheck(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer));
+			glCheck(glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER));
+		}
+
+		if (slot.fence)
+			glCheck(glDeleteSync(slot.fence));
+
+		glCheck(glDeleteBuffers(1, &slot.buffer));
+	}
+
+	glCheck(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+}
+
+unsigned int
+TextureUploader::map() {
+
+	unsigned int index = _next;
+	Slot&        slot  = _slots[index];
+
+	if (slot.data)
+		UTIL_THROW_EXCEPTION(
+				OpenGlError,
+				"all " << _slots.size() << " buffers are mapped, upload one before mapping another");
+
+	_next = (_next + 1)%_slots.size();
+
+	// buffers are created when they are needed for the first time, such that 
+	// callers that never have more than one in flight pay for one only
+	if (!slot.buffer) {
+
+		LOG_ALL(textureuploaderlog) << "creating buffer " << index << std::endl;
+
+		glCheck(glGenBuffers(1, &slot.buffer));
+		glCheck(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer));
+		glCheck(glBufferData(GL_PIXEL_UNPACK_BUFFER, _size, 0, GL_STREAM_DRAW));
+
+	} else {
+
+		glCheck(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer));
+	}
+
+	if (_useFences) {
+
+		wait(slot);
+
+		// the GPU is done with this buffer, no need to synchronize again
+		slot.data = glMapBufferRange(
+				GL_PIXEL_UNPACK_BUFFER,
+				0,
+				_size,
+				GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+
+	} else {
+
+		// give the driver new storage, instead of waiting for the old one
+		glCheck(glBufferData(GL_PIXEL_UNPACK_BUFFER, _size, 0, GL_STREAM_DRAW));
+		slot.data = glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+	}
+
+	glCheck(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+
+	if (!slot.data)
+		UTIL_THROW_EXCEPTION(
+				OpenGlError,
+				"could not map pixel buffer of " << _size << " bytes");
+
+	return index;
+}
+
+void
+TextureUploader::upload(unsigned int index, Texture& texture, GLint xoffset, GLint yoffset) {
+
+	Slot& slot = _slots[index];
+
+	if (!slot.data)
+		UTIL_THROW_EXCEPTION(
+				OpenGlError,
+				"buffer " << index << " has to be mapped before uploading it");
+
+	glCheck(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer));
+	glCheck(glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER));
+	slot.data = 0;
+
+	// rows are tightly packed
+	glCheck(glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT));
+	glCheck(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+
+	texture.bind();
+	glCheck(glTexSubImage2D(GL_TEXTURE_2D, 0, xoffset, yoffset, _width, _height, texture.uploadFormat(_format), _type, 0));
+	texture.unbind();
+
+	glCheck(glPopClientAttrib());
+
+	if (_useFences)
+		slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	glCheck(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+}
+
+void
+TextureUploader::wait(Slot& slot) {
+
+	if (!slot.fence)
+		return;
+
+	// one second, in nanoseconds
+	const GLuint64 timeout = 1000000000;
+
+	GLenum result;
+	while ((result = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout)) == GL_TIMEOUT_EXPIRED)
+		LOG_DEBUG(textureuploaderlog) << "still waiting for the GPU to read a buffer" << std::endl;
+
+	glCheck(glDeleteSync(slot.fence));
+	slot.fence = 0;
+
+	if (result == GL_WAIT_FAILED)
+		UTIL_THROW_EXCEPTION(
+				OpenGlError,
+				"waiting for a pixel buffer fence failed");
+}
+
+} // namespace sg_gui
@@ -0,0 +1,129 @@
+#ifndef SG_GUI_TEXTURE_UPLOADER_H__
+#define SG_GUI_TEXTURE_UPLOADER_H__
+
+#include <vector>
+#include "OpenGl.h"
+#include "Texture.h"
+
+namespace sg_gui {
+
+/**
+ * Streams images of a fixed size into textures through a ring of pixel buffer
+ * objects, such that filling the next image on the CPU overlaps with the GPU
+ * reading the previous ones.
+ *
+ * Usage, for each image:
+ *
+ *   unsigned int slot = uploader.map();              // OpenGl thread
+ *   fill(uploader.getData<float>(slot));             // any thread
+ *   uploader.upload(slot, texture);                  // OpenGl thread
+ *
+ * upload() returns right away, the copy into the texture happens
+ * asynchronously. Up to the number of buffers of the ring can be mapped at
+ * the same time. Filling and uploading only overlap if the caller makes them:
+ * by filling the next buffer while the GPU copies the previous one, or by
+ * handing mapped buffers to a producer thread while the OpenGl thread uploads
+ * others.
+ *
+ * If supported, buffers are mapped unsynchronized and a fence per buffer
+ * makes sure the GPU finished reading it before it gets mapped again.
+ * Otherwise, the storage of each buffer is orphaned before mapping.
+ */
+class TextureUploader {
+
+public:
+
+	/**
+	 * Check whether the current OpenGl context supports mapping buffer ranges
+	 * and fences.
+	 */
+	static bool isSupported();
+
+	/**
+	 * Create an uploader for images of the given size, in the given OpenGl
+	 * format and type (e.g., GL_RGBA and GL_UNSIGNED_BYTE), with a ring of up
+	 * to numBuffers buffers. Each buffer is created on its first map().
+	 */
+	TextureUploader(
+			GLsizei      width,
+			GLsizei      height,
+			GLenum       format,
+			GLenum       type,
+			unsigned int numBuffers = 3);
+
+	/**
+	 * Frees all buffers, after the GPU is done with them.
+	 */
+	~TextureUploader();
+
+	/**
+	 * Map the next buffer of the ring for writing. Waits for the GPU to finish
+	 * reading it, if needed. Returns the slot of the buffer, to be passed to
+	 * getData() and upload().
+	 */
+	unsigned int map();
+
+	/**
+	 * Get the memory of a mapped buffer, width*height pixels row by row.
+	 */
+	template <typename PixelType>
+	PixelType* getData(unsigned int slot) { return static_cast<PixelType*>(_slots[slot].data); }
+
+	/**
+	 * Unmap a buffer and copy its content into the given texture, at the
+	 * given offset. The texture has to be allocated already.
+	 */
+	void upload(unsigned int slot, Texture& texture, GLint xoffset = 0, GLint yoffset = 0);
+
+	GLsizei width()  const { return _width; }
+	GLsizei height() const { return _height; }
+	GLenum  format() const { return _format; }
+	GLenum  type()   const { return _type; }
+
+	/**
+	 * The size of an image in bytes.
+	 */
+	std::size_t size() const { return _size; }
+
+private:
+
+	struct Slot {
+
+		Slot() : buffer(0), fence(0), data(0) {}
+
+		// 0 until the slot is mapped for the first time
+		GLuint buffer;
+
+		// set after an upload from this buffer, until it is mapped again
+		GLsync fence;
+
+		// the mapped memory, 0 if not mapped
+		void* data;
+	};
+
+	/**
+	 * Block until the GPU passed the fence of the given slot, and delete the
+	 * fence.
+	 */
+	void wait(Slot& slot);
+
+	GLsizei _width;
+	GLsizei _height;
+	GLenum  _format;
+	GLenum  _type;
+
+	std::size_t _size;
+
+	// map unsynchronized and use fences
+	bool _useFences;
+
+	std::vector<Slot> _slots;
+
+	// the slot to map next
+	unsigned int _next;
+};
+
+} // namespace sg_gui
+
+#endif // SG_GUI_TEXTURE_UPLOADER_H__
+
@@ -0,0 +1,61 @@
+#include <algorithm>
+#include "ThreadPool.h"
+
+namespace sg_gui {
+
+ThreadPool::ThreadPool(unsigned int numThreads) :
+	_stop(false) {
+
+	if (numThreads == 0)
+		numThreads = std::max(1u, std::thread::hardware_concurrency());
+
+	for (unsigned int i = 0; i < numThreads; i++)
+		_threads.emplace_back(&ThreadPool::work, this);
+}
+
+ThreadPool::~ThreadPool() {
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+	}
+
+	_jobAvailable.notify_all();
+
+	for (std::thread& thread : _threads)
+		thread.join();
+}
+
+std::size_t
+ThreadPool::getQueueSize() {
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	return _jobs.size();
+}
+
+void
+ThreadPool::work() {
+
+	while (true) {
+
+		std::function<void()> job;
+
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+
+			_jobAvailable.wait(lock, [this]{ return _stop || !_jobs.empty(); });
+
+			// finish all remaining jobs before stopping
+			if (_jobs.empty())
+				return;
+
+			job = std::move(_jobs.front());
+			_jobs.pop_front();
+		}
+
+		job();
+	}
+}
+
+} // namespace sg_gui
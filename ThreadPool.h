@@ -0,0 +1,94 @@
+#ifndef SG_GUI_THREAD_POOL_H__
+#define SG_GUI_THREAD_POOL_H__
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sg_gui {
+
+/**
+ * A fixed number of worker threads processing jobs in the order they were
+ * scheduled.
+ */
+class ThreadPool {
+
+public:
+
+	/**
+	 * Create a pool with the given number of threads. If numThreads is 0, one
+	 * thread per hardware thread is used.
+	 */
+	ThreadPool(unsigned int numThreads = 0);
+
+	/**
+	 * Finishes all scheduled jobs and joins the worker threads.
+	 */
+	~ThreadPool();
+
+	/**
+	 * Schedule a function for execution.
+	 *
+	 * @return A future of the result of the function.
+	 */
+	template <typename F>
+	std::future<typename std::result_of<F()>::type> schedule(F function);
+
+	/**
+	 * The number of jobs that were scheduled but not started yet.
+	 */
+	std::size_t getQueueSize();
+
+	/**
+	 * The number of worker threads of this pool.
+	 */
+	std::size_t getNumThreads() const { return _threads.size(); }
+
+private:
+
+	void work();
+
+	std::vector<std::thread> _threads;
+
+	std::deque<std::function<void()>> _jobs;
+
+	std::mutex _mutex;
+
+	std::condition_variable _jobAvailable;
+
+	bool _stop;
+};
+
+/*****************
+ * IMPLEMENTAION *
+ *****************/
+
+template <typename F>
+std::future<typename std::result_of<F()>::type>
+ThreadPool::schedule(F function) {
+
+	typedef typename std::result_of<F()>::type result_type;
+
+	// std::function needs a copyable target
+	auto task = std::make_shared<std::packaged_task<result_type()>>(std::move(function));
+	std::future<result_type> future = task->get_future();
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_jobs.push_back([task](){ (*task)(); });
+	}
+
+	_jobAvailable.notify_one();
+
+	return future;
+}
+
+} // namespace sg_gui
+
+#endif // SG_GUI_THREAD_POOL_H__
+
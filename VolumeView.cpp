@@ -16,6 +16,16 @@ VolumeView::setVolume(std::shared_ptr<ExplicitVolume<float>> volume) {
 
 	_volume = volume;
 
+	volumeChanged();
+}
+
+void
+VolumeView::volumeChanged() {
+
+	// computed once per change, such that sections do not have to be scanned
+	// again and are all shown the same way
+	_statistics = std::make_shared<ImageStatistics>(&(*_volume->begin()), _volume->size());
+
 	updateImage();
 }
 
@@ -91,7 +101,7 @@ VolumeView::updateImage() {
 
 	*image = _volume->slice(_index);
 
-	sendInner<SetImage>(image);
+	sendInner<SetImage>(image, _statistics);
 }
 
 } // namespace sg_gui
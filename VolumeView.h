@@ -46,6 +46,12 @@ public:
 
 	void setVolume(std::shared_ptr<ExplicitVolume<float>> volume);
 
+	/**
+	 * Call after modifying the values of the current volume, to recompute the
+	 * statistics and to show the modified section.
+	 */
+	void volumeChanged();
+
 	void onSignal(PointerDown& signal);
 
 	void onSignal(QuerySize& signal);
@@ -65,6 +71,9 @@ private:
 
 	std::shared_ptr<ExplicitVolume<float>> _volume;
 
+	// statistics of the whole volume, shared by all sections
+	std::shared_ptr<const ImageStatistics> _statistics;
+
 	int _index;
 
 	util::point<float,3> _prevPointerDown;
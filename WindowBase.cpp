@@ -35,6 +35,11 @@ util::ProgramOption optionWindowBackgroundBlue(
 		util::_description_text = "The blue component of the window background color, between 0 and 1.",
 		util::_default_value    = 0.2);
 
+util::ProgramOption optionNoOrderIndependentTransparency(
+		util::_module           = "gui",
+		util::_long_name        = "noOrderIndependentTransparency",
+		util::_description_text = "Don't use weighted blended order-independent transparency for views that support it, but blend in drawing order.");
+
 namespace sg_gui {
 
 logger::LogChannel winlog("winlog", "[WindowBase] ");
@@ -58,10 +63,12 @@ WindowBase::WindowBase(std::string caption) :
 
 WindowBase::~WindowBase() {
 
-	sg_gui::OpenGl::Guard guard;
-
 	LOG_DEBUG(winlog) << "[" << getCaption() << "] destructing..." << std::endl;
 
+	deleteOitBuffer();
+
+	sg_gui::OpenGl::Guard guard;
+
 	deleteFrameBuffer();
 
 	LOG_DEBUG(winlog) << "[" << getCaption() << "] destructed" << std::endl;
@@ -159,11 +166,25 @@ WindowBase::redraw() {
 	DrawTranslucent drawTranslucentSignal;
 	drawTranslucentSignal.roi() = _region;
 	drawTranslucentSignal.resolution() = util::point<float,2>(1.0, 1.0);
+	drawTranslucentSignal.orderIndependent() = (_oitBuffer != 0);
 	glDepthMask(false);
 	sendInner(drawTranslucentSignal);
 	glDepthMask(true);
 
-	if (drawOpaqueSignal.needsRedraw() || drawTranslucentSignal.needsRedraw()) {
+	// ...and translucent content that doesn't depend on the drawing order, 
+	// if any view has some
+	DrawOrderIndependentTranslucent drawOitSignal;
+	if (_oitBuffer && drawTranslucentSignal.hasOrderIndependentContent()) {
+
+		LOG_ALL(winlog) << "[" << getCaption() << "] drawing order-independent translucent content" << std::endl;
+		drawOitSignal.roi() = _region;
+		drawOitSignal.resolution() = util::point<float,2>(1.0, 1.0);
+		_oitBuffer->begin();
+		sendInner(drawOitSignal);
+		_oitBuffer->end();
+	}
+
+	if (drawOpaqueSignal.needsRedraw() || drawTranslucentSignal.needsRedraw() || drawOitSignal.needsRedraw()) {
 
 		LOG_ALL(winlog) << "[" << getCaption() << "] painter indicated redraw request -- set myself dirty again" << std::endl;
 		setDirty();
@@ -210,6 +231,7 @@ WindowBase::processResizeEvent(int width, int height) {
 
 		configureViewport();
 		createFrameBuffer();
+		createOitBuffer();
 	}
 
 	// prepare painters
@@ -223,6 +245,9 @@ WindowBase::processResizeEvent(int width, int height) {
 void
 WindowBase::processCloseEvent(){
 
+	// needs our context, which is about to go
+	deleteOitBuffer();
+
 	LOG_DEBUG(winlog) << "[" << getCaption() << "] invalidating my GlContext" << std::endl;
 
 	// ensure that our context is destructed
@@ -280,6 +305,39 @@ WindowBase::createFrameBuffer() {
 	_frameBuffer = new unsigned char[(int)_resolution.x()*(int)_resolution.y()*3];
 }
 
+void
+WindowBase::createOitBuffer() {
+
+	if (optionNoOrderIndependentTransparency)
+		return;
+
+	if (!_oitBuffer) {
+
+		if (!OitBuffer::isSupported()) {
+
+			LOG_USER(winlog) << "[" << getCaption() << "] order-independent transparency is not supported, falling back to blending in drawing order" << std::endl;
+			return;
+		}
+
+		_oitBuffer.reset(new OitBuffer());
+	}
+
+	_oitBuffer->resize(_resolution.x(), _resolution.y());
+}
+
+void
+WindowBase::deleteOitBuffer() {
+
+	if (!_oitBuffer)
+		return;
+
+	// frame buffer objects are not shared between contexts, delete it in the
+	// one it was created in
+	OpenGl::Guard guard(this);
+
+	_oitBuffer.reset();
+}
+
 void
 WindowBase::deleteFrameBuffer() {
 
@@ -1,6 +1,7 @@
 #ifndef SG_GUI_WINDOW_BASE_H__
 #define SG_GUI_WINDOW_BASE_H__
 
+#include <memory>
 #include <string>
 
 #include <scopegraph/Scope.h>
@@ -14,6 +15,7 @@
 #include <sg_gui/Keys.h>
 #include <sg_gui/Buttons.h>
 #include <sg_gui/Modifiers.h>
+#include <sg_gui/OitBuffer.h>
 #include <util/box.hpp>
 #include <util/point.hpp>
 #include <config.h>
@@ -33,6 +35,7 @@ class WindowBase :
 				sg::ProvidesInner<
 						DrawOpaque,
 						DrawTranslucent,
+						DrawOrderIndependentTranslucent,
 						Resize,
 						KeyDown,
 						KeyUp,
@@ -370,6 +373,17 @@ private:
 	 */
 	void createFrameBuffer();
 
+	/**
+	 * Create or resize the buffers for order-independent transparency.
+	 */
+	void createOitBuffer();
+
+	/**
+	 * Release the buffers for order-independent transparency in the context 
+	 * of this window.
+	 */
+	void deleteOitBuffer();
+
 	/**
 	 * Free memory of the frame buffer.
 	 */
@@ -398,6 +412,10 @@ private:
 	// the background color of this window
 	float _clear_r, _clear_g, _clear_b;
 
+	// accumulation buffers for order-independent transparency, if enabled and 
+	// supported
+	std::unique_ptr<OitBuffer> _oitBuffer;
+
 	bool _dirty;
 };
 